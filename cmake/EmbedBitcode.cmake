@@ -0,0 +1,16 @@
+# Embed the bitcode file INPUT as a byte array by configuring TEMPLATE into
+# OUTPUT; the template receives the bytes as `LIMONCELLO_BITCODE_BYTES`.
+#
+# Usage: cmake -DINPUT=... -DTEMPLATE=... -DOUTPUT=... -P EmbedBitcode.cmake
+
+file(READ "${INPUT}" LIMONCELLO_BITCODE_BYTES HEX)
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, "
+       LIMONCELLO_BITCODE_BYTES "${LIMONCELLO_BITCODE_BYTES}")
+
+# Wrap lines after every twelve bytes (CMake regexes lack `{n}` quantifiers).
+set(byte "0x[0-9a-f][0-9a-f], ")
+set(line "${byte}${byte}${byte}${byte}${byte}${byte}")
+string(REGEX REPLACE "(${line}${line})" "\\1\n    "
+       LIMONCELLO_BITCODE_BYTES "${LIMONCELLO_BITCODE_BYTES}")
+
+configure_file("${TEMPLATE}" "${OUTPUT}" @ONLY)
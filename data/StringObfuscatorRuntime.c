@@ -0,0 +1,191 @@
+//===-- StringObfuscatorRuntime.c - String deobfuscation runtime ----------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file is compiled to bitcode at build time and embedded into the plugin;
+// its functions are cloned into every module that has obfuscated strings.
+//
+// There are several variants of the deobfuscation kernel; the widest one the
+// CPU (and OS) supports is selected on first use and cached. An ifunc would
+// avoid the indirect call, but is ELF-only and doesn't survive the runtime
+// being cloned into modules as private symbols.
+//
+// The vectorized kernels and CPU feature checks only work on the architecture
+// the runtime was built for; modules for any other architecture get the
+// portable kernel (deobfuscateXORPortable) instead.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LIMONCELLO_RUNTIME_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define LIMONCELLO_RUNTIME_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef void (*DeobfuscateFn)(char *data, size_t size, uint8_t key);
+
+static void deobfuscateBytes(char *data, size_t size, uint8_t key) {
+  // Keep this the plain byte-at-a-time loop it claims to be, both as the
+  // reference implementation and so it can be benchmarked as such.
+#pragma clang loop vectorize(disable) interleave(disable) unroll(disable)
+  for (size_t i = 0; i < size; ++i)
+    data[i] ^= key;
+}
+
+static void deobfuscateWords(char *data, size_t size, uint8_t key) {
+  uint64_t wideKey = key * 0x0101010101010101ull;
+
+  size_t i = 0;
+#pragma clang loop vectorize(disable) interleave(disable)
+  for (; i + sizeof(wideKey) <= size; i += sizeof(wideKey)) {
+    uint64_t word;
+    __builtin_memcpy(&word, data + i, sizeof(word));
+    word ^= wideKey;
+    __builtin_memcpy(data + i, &word, sizeof(word));
+  }
+
+  deobfuscateBytes(data + i, size - i, key);
+}
+
+#if LIMONCELLO_RUNTIME_X86
+__attribute__((target("sse2"))) static void
+deobfuscateSSE2(char *data, size_t size, uint8_t key) {
+  __m128i wideKey = _mm_set1_epi8((char)key);
+
+  size_t i = 0;
+  for (; i + sizeof(wideKey) <= size; i += sizeof(wideKey)) {
+    __m128i *chunk = (__m128i *)(data + i);
+    _mm_storeu_si128(chunk, _mm_xor_si128(_mm_loadu_si128(chunk), wideKey));
+  }
+
+  deobfuscateWords(data + i, size - i, key);
+}
+
+__attribute__((target("avx2"))) static void
+deobfuscateAVX2(char *data, size_t size, uint8_t key) {
+  __m256i wideKey = _mm256_set1_epi8((char)key);
+
+  size_t i = 0;
+  for (; i + sizeof(wideKey) <= size; i += sizeof(wideKey)) {
+    __m256i *chunk = (__m256i *)(data + i);
+    _mm256_storeu_si256(chunk,
+                        _mm256_xor_si256(_mm256_loadu_si256(chunk), wideKey));
+  }
+
+  deobfuscateSSE2(data + i, size - i, key);
+}
+
+__attribute__((target("avx512f"))) static void
+deobfuscateAVX512(char *data, size_t size, uint8_t key) {
+  __m512i wideKey = _mm512_set1_epi8((char)key);
+
+  size_t i = 0;
+  for (; i + sizeof(wideKey) <= size; i += sizeof(wideKey)) {
+    void *chunk = data + i;
+    _mm512_storeu_si512(chunk,
+                        _mm512_xor_si512(_mm512_loadu_si512(chunk), wideKey));
+  }
+
+  deobfuscateAVX2(data + i, size - i, key);
+}
+
+/// Tells whether the OS saves all of the register state in \p mask (per
+/// XCR0) on context switches.
+static int isRegisterStateEnabled(uint64_t mask) {
+  uint32_t lo, hi;
+  __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return ((((uint64_t)hi << 32) | lo) & mask) == mask;
+}
+
+enum {
+  RegisterStateAVX = 0x06,    // XMM, YMM
+  RegisterStateAVX512 = 0xe6, // XMM, YMM, opmask, ZMM
+};
+
+static int hasSSE2Support(void) {
+  // SSE2 is baseline on x86-64, but not on 32-bit x86.
+  unsigned eax, ebx, ecx, edx;
+  return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & bit_SSE2);
+}
+
+static int hasAVX2Support(void) {
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return 0;
+  if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX) ||
+      !isRegisterStateEnabled(RegisterStateAVX))
+    return 0;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    return 0;
+
+  return (ebx & bit_AVX2) != 0;
+}
+
+static int hasAVX512Support(void) {
+  unsigned eax, ebx, ecx, edx;
+  if (!hasAVX2Support() || !isRegisterStateEnabled(RegisterStateAVX512))
+    return 0;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    return 0;
+
+  return (ebx & bit_AVX512F) != 0;
+}
+#endif
+
+#if LIMONCELLO_RUNTIME_NEON
+static void deobfuscateNEON(char *data, size_t size, uint8_t key) {
+  uint8x16_t wideKey = vdupq_n_u8(key);
+
+  size_t i = 0;
+  for (; i + sizeof(wideKey) <= size; i += sizeof(wideKey)) {
+    uint8_t *chunk = (uint8_t *)(data + i);
+    vst1q_u8(chunk, veorq_u8(vld1q_u8(chunk), wideKey));
+  }
+
+  deobfuscateWords(data + i, size - i, key);
+}
+#endif
+
+static DeobfuscateFn selectDeobfuscate(void) {
+#if LIMONCELLO_RUNTIME_X86
+  if (hasAVX512Support())
+    return deobfuscateAVX512;
+  if (hasAVX2Support())
+    return deobfuscateAVX2;
+  if (hasSSE2Support())
+    return deobfuscateSSE2;
+#elif LIMONCELLO_RUNTIME_NEON
+  return deobfuscateNEON;
+#endif
+
+  return deobfuscateWords;
+}
+
+/// Selected kernel; every thread selects the same one, so racing to fill this
+/// in is harmless as long as the accesses themselves are atomic.
+static DeobfuscateFn selectedDeobfuscate;
+
+void deobfuscateXORPortable(char *data, size_t size, uint8_t key) {
+  deobfuscateWords(data, size, key);
+}
+
+void deobfuscateXOR(char *data, size_t size, uint8_t key) {
+  DeobfuscateFn impl = __atomic_load_n(&selectedDeobfuscate, __ATOMIC_RELAXED);
+  if (!impl) {
+    impl = selectDeobfuscate();
+    __atomic_store_n(&selectedDeobfuscate, impl, __ATOMIC_RELAXED);
+  }
+
+  impl(data, size, key);
+}
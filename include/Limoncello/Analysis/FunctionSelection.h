@@ -0,0 +1,85 @@
+//===-- Analysis/FunctionSelection.h - Per-module pass selection cache ----===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_ANALYSIS_FUNCTIONSELECTION_H
+#define LIMONCELLO_ANALYSIS_FUNCTIONSELECTION_H
+
+#include "Limoncello/Config/FunctionOverride.h"
+#include "Limoncello/Config/PassConfig.h"
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/ValueHandle.h>
+
+#include <optional>
+
+/// Cache of which functions in a module each pass should run on.
+///
+/// Every function present when the analysis runs is assigned a dense index;
+/// the first time a pass asks about any function, its patterns are evaluated
+/// once for the whole module and stored as a bitmap. Functions created later
+/// on (e.g. runtime or stub functions) are matched directly.
+///
+/// Overrides given in the source (see `FunctionOverride`) are parsed once, up
+/// front, and folded into the bitmaps, so they cost nothing per query.
+///
+/// Since decisions only depend on function names, the result is never
+/// invalidated; function names are assumed to be stable, and deleted functions
+/// are detected via value handles.
+class FunctionSelection {
+  llvm::DenseMap<llvm::Function const *, unsigned> m_indices;
+  llvm::SmallVector<llvm::WeakVH> m_functions;
+  llvm::DenseMap<unsigned, FunctionOverride> m_overrides;
+  mutable llvm::DenseMap<PassConfig const *, llvm::BitVector> m_decisions;
+
+  /// Get the index of \p func, or null if it wasn't present when the analysis
+  /// ran.
+  std::optional<unsigned> getIndex(llvm::Function const &func) const;
+
+  /// Get (or compute) the decision bitmap for \p config.
+  llvm::BitVector const &getDecisions(PassConfig const &config) const;
+
+public:
+  explicit FunctionSelection(llvm::Module &module);
+
+  /// Tells whether the pass configured by \p config should run on \p func.
+  bool shouldRunOnFunction(PassConfig const &config,
+                           llvm::Function const &func) const;
+
+  /// Get the overrides given for \p func, if any.
+  FunctionOverride const *getOverride(llvm::Function const &func) const;
+
+  /// Tells whether any function opted out of the pass configured by
+  /// \p config through an override.
+  bool hasOptOuts(PassConfig const &config) const;
+
+  bool invalidate(llvm::Module &, llvm::PreservedAnalyses const &,
+                  llvm::ModuleAnalysisManager::Invalidator &) {
+    return false;
+  }
+};
+
+/// Analysis producing a `FunctionSelection` for a module.
+///
+/// This is a module analysis, but is also consulted by function passes (such
+/// as the flattener) through the outer analysis manager proxy; it must be
+/// required at the module level before any such passes run.
+class FunctionSelectionAnalysis
+    : public llvm::AnalysisInfoMixin<FunctionSelectionAnalysis> {
+  friend llvm::AnalysisInfoMixin<FunctionSelectionAnalysis>;
+  static llvm::AnalysisKey Key;
+
+public:
+  using Result = FunctionSelection;
+
+  static Result run(llvm::Module &module, llvm::ModuleAnalysisManager &);
+};
+
+#endif
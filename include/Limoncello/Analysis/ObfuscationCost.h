@@ -0,0 +1,127 @@
+//===-- Analysis/ObfuscationCost.h - Hotness-aware obfuscation budget -----===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_ANALYSIS_OBFUSCATIONCOST_H
+#define LIMONCELLO_ANALYSIS_OBFUSCATIONCOST_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/ValueHandle.h>
+
+#include <map>
+
+namespace llvm {
+class BlockFrequencyInfo;
+class ProfileSummaryInfo;
+} // namespace llvm
+
+/// Runtime overhead a function may take on, and how much of it has already
+/// been spent by previous passes.
+struct OverheadBudget {
+  llvm::WeakVH function;
+  double limit = 0;
+  double spent = 0;
+};
+
+/// Estimates how expensive transforming each part of a function would be.
+///
+/// Costs are given as the number of extra instructions a transformation makes
+/// a block execute each time it runs; these are weighted by how often the block
+/// runs per call of the function (from real profile data if present, static
+/// estimates otherwise) and charged against the function's budget.
+///
+/// A default-constructed model (used when the cost model is disabled) allows
+/// everything.
+class FunctionCostModel {
+  struct BlockInfo {
+    double frequency;
+    bool isHot;
+  };
+
+  llvm::DenseMap<llvm::BasicBlock const *, BlockInfo> m_blocks;
+  OverheadBudget *m_budget = nullptr;
+  bool m_isHot = false;
+
+  /// Get the info for \p block, or for the closest block it was split off
+  /// from if it was created after the model.
+  BlockInfo const *lookup(llvm::BasicBlock const &block) const;
+
+public:
+  FunctionCostModel() = default;
+  FunctionCostModel(llvm::Function const &func,
+                    llvm::BlockFrequencyInfo &bfi,
+                    llvm::ProfileSummaryInfo const *psi,
+                    OverheadBudget &budget);
+
+  /// Tells whether the function is hot enough to be left alone entirely.
+  bool isFunctionHot() const { return m_isHot; }
+
+  /// Tells whether \p block is hot enough to never be transformed.
+  bool isBlockHot(llvm::BasicBlock const &block) const;
+
+  /// Get the number of times \p block is expected to run per call.
+  double getRelativeFrequency(llvm::BasicBlock const &block) const;
+
+  /// Get the number of instructions the function is expected to execute per
+  /// call, i.e. the baseline the budget is relative to.
+  double getEstimatedInstructionCount() const;
+
+  /// Charge \p cost extra instructions per execution of \p block to the
+  /// budget. Returns false (without charging anything) if \p block is hot or
+  /// the budget would be exceeded.
+  bool trySpend(llvm::BasicBlock const &block, double cost);
+
+  /// Charge \p cost extra instructions per call to the budget. Returns false
+  /// (without charging anything) if the budget would be exceeded.
+  bool trySpend(double cost);
+};
+
+/// Per-module ledger of the overhead budgets of every function.
+///
+/// Budgets are shared by all passes, so that e.g. a function which was heavily
+/// bloated has less left over for the flattener. Like `FunctionSelection`,
+/// this is never invalidated.
+class ObfuscationCost {
+  mutable std::map<llvm::Function const *, OverheadBudget> m_budgets;
+
+  FunctionCostModel getModel(llvm::Function &func,
+                             llvm::BlockFrequencyInfo &bfi,
+                             llvm::ProfileSummaryInfo const *psi) const;
+
+public:
+  /// Get the cost model for \p func from a module pass.
+  FunctionCostModel getModel(llvm::Function &func,
+                             llvm::ModuleAnalysisManager &mam) const;
+
+  /// Get the cost model for \p func from a function pass; profile data is
+  /// only used if it has already been computed for the module.
+  FunctionCostModel getModel(llvm::Function &func,
+                             llvm::FunctionAnalysisManager &fam) const;
+
+  bool invalidate(llvm::Module &, llvm::PreservedAnalyses const &,
+                  llvm::ModuleAnalysisManager::Invalidator &) {
+    return false;
+  }
+};
+
+/// Analysis producing the `ObfuscationCost` ledger for a module.
+class ObfuscationCostAnalysis
+    : public llvm::AnalysisInfoMixin<ObfuscationCostAnalysis> {
+  friend llvm::AnalysisInfoMixin<ObfuscationCostAnalysis>;
+  static llvm::AnalysisKey Key;
+
+public:
+  using Result = ObfuscationCost;
+
+  static Result run(llvm::Module &, llvm::ModuleAnalysisManager &) {
+    return {};
+  }
+};
+
+#endif
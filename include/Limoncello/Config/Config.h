@@ -10,12 +10,16 @@
 #ifndef LIMONCELLO_CONFIG_CONFIG_H
 #define LIMONCELLO_CONFIG_CONFIG_H
 
+#include "Limoncello/Config/DispatchProfile.h"
+#include "Limoncello/Config/Hotness.h"
 #include "Limoncello/Config/Pass/ArithmeticMangler.h"
 #include "Limoncello/Config/Pass/Bloater.h"
 #include "Limoncello/Config/Pass/ConstantMangler.h"
 #include "Limoncello/Config/Pass/Flattener.h"
 #include "Limoncello/Config/Pass/StringObfuscator.h"
 
+#include <array>
+
 /// Top-level obfuscator configuration structure.
 class Config {
   /// Create the default configuration.
@@ -39,12 +43,36 @@ public:
   /// Seed for the obfuscator's RNG; random if not provided.
   unsigned seed;
 
+  /// Number of partitions to split modules into for parallel obfuscation;
+  /// modules are obfuscated as a whole if this is less than two.
+  unsigned partitions;
+
+  /// Number of threads to obfuscate partitions on; all hardware threads are
+  /// used if not provided. Does not affect the obfuscator's output.
+  unsigned threads;
+
+  /// Cost model used to keep obfuscation out of hot code.
+  HotnessConfig hotness;
+
+  /// Profiling of dispatch points, and use of the resulting profiles.
+  DispatchProfileConfig dispatchProfile;
+
   ArithmeticManglerConfig arithmeticMangler;
   BloaterConfig bloater;
   ConstantManglerConfig constantMangler;
   FlattenerConfig flattener;
   StringObfuscatorConfig stringObfuscator;
 
+  /// Get the configs for all passes, in pipeline order.
+  std::array<PassConfig *, 5> getPassConfigs() {
+    return {&stringObfuscator, &bloater, &flattener, &constantMangler,
+            &arithmeticMangler};
+  }
+
+  /// Get the config of the pass called \p name in config files, or null if
+  /// there is no such pass.
+  PassConfig *getPassConfig(llvm::StringRef name);
+
   /// Load the global config from \p path.
   static Config *load(std::string path = "");
 
@@ -62,6 +90,10 @@ template <> struct llvm::yaml::MappingTraits<Config> {
   static void mapping(llvm::yaml::IO &io, Config &config) {
     io.mapOptional("debug", config.debug);
     io.mapOptional("seed", config.seed);
+    io.mapOptional("partitions", config.partitions);
+    io.mapOptional("threads", config.threads);
+    io.mapOptional("hotness", config.hotness);
+    io.mapOptional("dispatch-profile", config.dispatchProfile);
 
     io.mapOptional("arithmetic-mangler", config.arithmeticMangler);
     io.mapOptional("bloater", config.bloater);
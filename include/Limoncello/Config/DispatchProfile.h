@@ -0,0 +1,48 @@
+//===-- Config/DispatchProfile.h - Dispatch profiling configuration -------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_CONFIG_DISPATCHPROFILE_H
+#define LIMONCELLO_CONFIG_DISPATCHPROFILE_H
+
+#include <llvm/Support/YAMLTraits.h>
+
+#include <string>
+
+/// Configuration for profiling the dispatch points added by obfuscation (the
+/// states of flattened functions and the bloater's dispatch blocks), and for
+/// feeding such a profile back into the next build.
+class DispatchProfileConfig {
+public:
+  /// Count how often every dispatch point is executed, and append the counts
+  /// to `output` when the program exits.
+  bool instrument = false;
+
+  /// Path instrumented programs write their profile to; relative paths are
+  /// relative to the working directory of the program.
+  std::string output = "limoncello.dispatchprof";
+
+  /// Profile written by a previous instrumented build. Hot flattened
+  /// functions are left alone, and hot branches are not bloated.
+  std::string use;
+
+  /// Dispatch points are hot if they are among the most executed ones which
+  /// together make up this percentage of all dispatches in the profile.
+  unsigned hotPercentile = 90;
+};
+
+template <> struct llvm::yaml::MappingTraits<DispatchProfileConfig> {
+  static void mapping(IO &io, DispatchProfileConfig &config) {
+    io.mapOptional("instrument", config.instrument);
+    io.mapOptional("output", config.output);
+    io.mapOptional("use", config.use);
+    io.mapOptional("hot-percentile", config.hotPercentile);
+  }
+};
+
+#endif
@@ -0,0 +1,85 @@
+//===-- Config/FunctionMatcher.h - Precompiled function name pattern ------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_CONFIG_FUNCTIONMATCHER_H
+#define LIMONCELLO_CONFIG_FUNCTIONMATCHER_H
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Regex.h>
+
+#include <memory>
+#include <string>
+
+/// Compiled form of a single function selection pattern.
+///
+/// Patterns are (unanchored) regular expressions, optionally negated with a
+/// leading tilde. Most patterns seen in practice are really just literals,
+/// prefixes, or literals joined by `.*` wildcards; these are matched directly
+/// without going through the regex engine at all.
+class FunctionMatcher {
+public:
+  enum class Kind {
+    /// Matches every name, e.g. `.*`.
+    Any,
+
+    /// Matches a name exactly, e.g. `^main$`.
+    Exact,
+
+    /// Matches names starting with a literal, e.g. `^foo`.
+    Prefix,
+
+    /// Matches names ending with a literal, e.g. `foo$`.
+    Suffix,
+
+    /// Matches names containing a literal, e.g. `foo`.
+    Substring,
+
+    /// Matches names containing a sequence of literals, e.g. `^foo.*bar`.
+    Glob,
+
+    /// Anything else; falls back to `llvm::Regex`.
+    Regex,
+  };
+
+private:
+  Kind m_kind = Kind::Any;
+  bool m_isNegated = false;
+  bool m_isAnchoredStart = false;
+  bool m_isAnchoredEnd = false;
+
+  /// Literal segments of the pattern, split at each `.*` wildcard.
+  llvm::SmallVector<std::string, 2> m_segments;
+
+  /// Compiled regex; only present for patterns of the `Regex` kind.
+  std::shared_ptr<llvm::Regex> m_regex;
+
+  /// Try to parse \p body as a wildcard-separated list of literals.
+  bool parseGlob(llvm::StringRef body);
+
+  bool matchesGlob(llvm::StringRef name) const;
+
+public:
+  /// Compile \p pattern; use isValid() to check for errors afterwards.
+  explicit FunctionMatcher(llvm::StringRef pattern);
+
+  /// Tells whether the pattern compiled successfully; \p error will be
+  /// populated with a description of the problem otherwise.
+  bool isValid(std::string &error) const;
+
+  Kind getKind() const { return m_kind; }
+
+  /// Tells whether the pattern was negated with a leading tilde.
+  bool isNegated() const { return m_isNegated; }
+
+  /// Tells whether \p name is matched by the pattern (ignoring negation).
+  bool matches(llvm::StringRef name) const;
+};
+
+#endif
@@ -0,0 +1,75 @@
+//===-- Config/FunctionOverride.h - Per-function config overrides ---------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_CONFIG_FUNCTIONOVERRIDE_H
+#define LIMONCELLO_CONFIG_FUNCTIONOVERRIDE_H
+
+#include "Limoncello/Config/PassConfig.h"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <optional>
+#include <string>
+
+namespace llvm {
+class Function;
+class Module;
+} // namespace llvm
+
+class Config;
+
+/// Prefix of annotations holding override directives, e.g.
+/// `__attribute__((annotate("limoncello:no-flattener")))`.
+constexpr auto OverrideAnnotationPrefix = "limoncello:";
+
+/// Name of the function attribute holding override directives, for frontends
+/// (and tools) which can't emit annotations.
+constexpr auto OverrideAttributeName = "limoncello";
+
+/// Per-function overrides of the config, given in the source next to the
+/// function they apply to.
+///
+/// Overrides are comma-separated lists of directives:
+///
+///   - `no-<pass>` keeps a pass (named as in config files) off the function,
+///     and `none` keeps all of them off;
+///   - `bloater.rounds=<n>`, `bloater.probability=<n>`, and
+///     `arithmetic-mangler.rounds=<n>` replace the configured values.
+class FunctionOverride {
+public:
+  /// Passes which must not run on the function.
+  llvm::SmallVector<PassConfig const *, 1> disabledPasses;
+
+  std::optional<int> bloaterRounds;
+  std::optional<int> bloaterProbability;
+  std::optional<int> arithmeticManglerRounds;
+
+  /// Apply the directives in \p directives on top of the current overrides.
+  /// Returns false (and populates \p error) if any directive is invalid;
+  /// the valid ones are still applied.
+  bool parse(llvm::StringRef directives, Config &config, std::string &error);
+
+  /// Tells whether the pass configured by \p config is kept off the function.
+  bool isPassDisabled(PassConfig const &config) const;
+};
+
+/// Call \p callback with the override directives given for each function in
+/// \p module, through either annotations or function attributes; functions
+/// with several of them are visited once for each.
+void forEachOverride(
+    llvm::Module &module,
+    llvm::function_ref<void(llvm::Function &, llvm::StringRef)> callback);
+
+/// Copy all override annotations in \p module onto function attributes, which
+/// (unlike the annotations) stay with their functions when splitting modules.
+void copyOverrideAnnotationsToAttributes(llvm::Module &module);
+
+#endif
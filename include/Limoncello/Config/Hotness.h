@@ -0,0 +1,43 @@
+//===-- Config/Hotness.h - Hotness-aware cost model config ----------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_CONFIG_HOTNESS_H
+#define LIMONCELLO_CONFIG_HOTNESS_H
+
+#include <llvm/Support/YAMLTraits.h>
+
+/// Configuration for the cost model shared by all passes which transform
+/// function bodies.
+class HotnessConfig {
+public:
+  bool isEnabled = false;
+
+  /// Maximum estimated runtime overhead each function may take on, as a
+  /// percentage of the (estimated) number of instructions it executes per call.
+  unsigned budget = 25;
+
+  /// Leave functions which the profile summary considers hot alone entirely;
+  /// only has an effect if profile data is present.
+  bool skipHotFunctions = true;
+
+  /// Without profile data, blocks executed at least this many times per call
+  /// of their function (according to static estimates) are considered hot.
+  unsigned hotBlockFrequency = 16;
+};
+
+template <> struct llvm::yaml::MappingTraits<HotnessConfig> {
+  static void mapping(IO &io, HotnessConfig &config) {
+    io.mapOptional("enabled", config.isEnabled);
+    io.mapOptional("budget", config.budget);
+    io.mapOptional("skip-hot-functions", config.skipHotFunctions);
+    io.mapOptional("hot-block-frequency", config.hotBlockFrequency);
+  }
+};
+
+#endif
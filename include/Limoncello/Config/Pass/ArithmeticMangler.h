@@ -15,14 +15,31 @@
 class ArithmeticManglerConfig : public PassConfig {
 public:
   int rounds = 2;
+
+  /// Minimum number of instructions each rewrite should be made of; the
+  /// cheapest identities on the target which are at least that large are used.
+  unsigned strength = 3;
+
+  /// Rewrite expressions where they are used instead of extracting them into
+  /// stub functions first.
+  bool useInPlaceRewriting = false;
+
+  /// Maximum number of instructions each operation may be expanded into, or
+  /// zero for no limit. When set, subexpressions are shared across rounds,
+  /// and mangling stops early once the budget is spent.
+  unsigned budget = 0;
 };
 
 template <> struct llvm::yaml::MappingTraits<ArithmeticManglerConfig> {
   static void mapping(IO &io, ArithmeticManglerConfig &config) {
     io.mapOptional("enabled", config.isEnabled);
     io.mapOptional("patterns", config.patterns);
+    io.mapOptional("extension-point", config.extensionPoint);
 
     io.mapOptional("rounds", config.rounds);
+    io.mapOptional("strength", config.strength);
+    io.mapOptional("in-place", config.useInPlaceRewriting);
+    io.mapOptional("budget", config.budget);
   }
 };
 
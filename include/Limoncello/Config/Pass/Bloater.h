@@ -11,20 +11,27 @@
 #define LIMONCELLO_CONFIG_PASS_BLOATER_H
 
 #include "Limoncello/Config/PassConfig.h"
+#include "Limoncello/Support/OpaquePredicate.h"
 
 class BloaterConfig : public PassConfig {
 public:
   int rounds = 1;
   int probability = 50;
+
+  /// Kinds of opaque predicates to guard bloated branches with; one is picked
+  /// at random for each branch.
+  std::vector<OpaquePredicateKind> predicates = {OpaquePredicateKind::Call};
 };
 
 template <> struct llvm::yaml::MappingTraits<BloaterConfig> {
   static void mapping(IO &io, BloaterConfig &config) {
     io.mapOptional("enabled", config.isEnabled);
     io.mapOptional("patterns", config.patterns);
+    io.mapOptional("extension-point", config.extensionPoint);
 
     io.mapOptional("rounds", config.rounds);
     io.mapOptional("probability", config.probability);
+    io.mapOptional("predicates", config.predicates);
   }
 };
 
@@ -12,12 +12,39 @@
 
 #include "Limoncello/Config/PassConfig.h"
 
-class ConstantManglerConfig : public PassConfig {};
+/// Where the opaque value that mangled constants are derived from is loaded.
+enum class OpaqueLoadScope {
+  /// Load it again right before every mangled constant.
+  Use,
+
+  /// Load it once at the start of the function.
+  Function,
+
+  /// Load it once in the preheader of each outermost loop, and before every
+  /// mangled constant outside of loops.
+  Loop,
+};
+
+template <> struct llvm::yaml::ScalarEnumerationTraits<OpaqueLoadScope> {
+  static void enumeration(IO &io, OpaqueLoadScope &scope) {
+    io.enumCase(scope, "use", OpaqueLoadScope::Use);
+    io.enumCase(scope, "function", OpaqueLoadScope::Function);
+    io.enumCase(scope, "loop", OpaqueLoadScope::Loop);
+  }
+};
+
+class ConstantManglerConfig : public PassConfig {
+public:
+  OpaqueLoadScope opaqueLoadScope = OpaqueLoadScope::Use;
+};
 
 template <> struct llvm::yaml::MappingTraits<ConstantManglerConfig> {
   static void mapping(IO &io, ConstantManglerConfig &config) {
     io.mapOptional("enabled", config.isEnabled);
     io.mapOptional("patterns", config.patterns);
+    io.mapOptional("extension-point", config.extensionPoint);
+
+    io.mapOptional("opaque-load-scope", config.opaqueLoadScope);
   }
 };
 
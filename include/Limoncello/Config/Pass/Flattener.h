@@ -14,17 +14,37 @@
 
 class FlattenerConfig : public PassConfig {
 public:
+  /// Assign state IDs in a random order, rather than sequentially.
   bool useRandomCaseIds = false;
+
+  /// Upper bound (exclusive) on the first state ID when using random IDs; the
+  /// IDs themselves always form a dense range starting there.
   int maxRandomCases = 768;
+
+  /// Split large functions into regions with a dispatcher of their own, rather
+  /// than going through a single dispatcher for every block.
+  bool useRegions = false;
+
+  /// Number of blocks to (roughly) aim for in each region.
+  unsigned regionSize = 64;
+
+  /// End every flattened block with an indirect branch through a table of
+  /// block addresses, rather than going back to a shared dispatcher. Takes
+  /// precedence over regions.
+  bool useThreadedDispatch = false;
 };
 
 template <> struct llvm::yaml::MappingTraits<FlattenerConfig> {
   static void mapping(IO &io, FlattenerConfig &config) {
     io.mapOptional("enabled", config.isEnabled);
     io.mapOptional("patterns", config.patterns);
+    io.mapOptional("extension-point", config.extensionPoint);
 
     io.mapOptional("random-case-ids", config.useRandomCaseIds);
     io.mapOptional("max-random-cases", config.maxRandomCases);
+    io.mapOptional("regions", config.useRegions);
+    io.mapOptional("region-size", config.regionSize);
+    io.mapOptional("threaded-dispatch", config.useThreadedDispatch);
   }
 };
 
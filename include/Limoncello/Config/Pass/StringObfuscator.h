@@ -12,12 +12,30 @@
 
 #include "Limoncello/Config/PassConfig.h"
 
-class StringObfuscatorConfig : public PassConfig {};
+class StringObfuscatorConfig : public PassConfig {
+public:
+  /// Decrypt strings on first use instead of all at once on startup.
+  bool isLazy = false;
+
+  /// Maximum combined size (in bytes) of strings sharing a single once-flag
+  /// when decrypting lazily; strings get a flag of their own if zero.
+  int lazyGroupSize = 0;
+
+  /// Align the packed string table to (and pad it out to) whole pages, so that
+  /// no other data shares the pages decryption dirties. This costs up to a
+  /// page per module, so it is best left to single-module programs.
+  bool isTablePageAligned = false;
+};
 
 template <> struct llvm::yaml::MappingTraits<StringObfuscatorConfig> {
   static void mapping(IO &io, StringObfuscatorConfig &config) {
     io.mapOptional("enabled", config.isEnabled);
     io.mapOptional("patterns", config.patterns);
+    io.mapOptional("extension-point", config.extensionPoint);
+
+    io.mapOptional("lazy", config.isLazy);
+    io.mapOptional("lazy-group-size", config.lazyGroupSize);
+    io.mapOptional("page-aligned-table", config.isTablePageAligned);
   }
 };
 
@@ -10,18 +10,72 @@
 #ifndef LIMONCELLO_CONFIG_PASSCONFIG_H
 #define LIMONCELLO_CONFIG_PASSCONFIG_H
 
+#include "Limoncello/Config/FunctionMatcher.h"
+
 #include <llvm/IR/Function.h>
 #include <llvm/Support/YAMLTraits.h>
 
 #include <string>
 
+/// Points in the optimization pipeline passes can be placed at, in the order
+/// they run in.
+///
+/// ThinLTO runs the optimizer extension points both before and after linking;
+/// when placing passes there, only load the plugin for one of the two.
+enum class ExtensionPoint {
+  /// Before any optimization takes place.
+  PipelineStart,
+
+  /// After early simplification (e.g. SROA and early CSE), before inlining.
+  PipelineEarlySimplification,
+
+  /// After inlining and function (and loop) simplification, right before
+  /// vectorization and loop unrolling.
+  OptimizerEarly,
+
+  /// At the very end of the per-module optimization pipeline.
+  OptimizerLast,
+
+  /// At the very end of the full LTO pipeline; passes placed here only ever
+  /// run when linking with full LTO.
+  FullLTOLast,
+};
+
+template <> struct llvm::yaml::ScalarEnumerationTraits<ExtensionPoint> {
+  static void enumeration(IO &io, ExtensionPoint &extensionPoint) {
+    io.enumCase(extensionPoint, "pipeline-start",
+                ExtensionPoint::PipelineStart);
+    io.enumCase(extensionPoint, "pipeline-early-simplification",
+                ExtensionPoint::PipelineEarlySimplification);
+    io.enumCase(extensionPoint, "optimizer-early",
+                ExtensionPoint::OptimizerEarly);
+    io.enumCase(extensionPoint, "optimizer-last",
+                ExtensionPoint::OptimizerLast);
+    io.enumCase(extensionPoint, "full-lto-last", ExtensionPoint::FullLTOLast);
+  }
+};
+
 /// Base pass configuration structure.
 class PassConfig {
 public:
   bool isEnabled = false;
   std::vector<std::string> patterns{};
 
+  /// Where in the optimization pipeline the pass runs; passes must still be
+  /// placed in their usual order relative to each other.
+  ExtensionPoint extensionPoint = ExtensionPoint::PipelineStart;
+
+  /// Compiled form of \p patterns; populated by compilePatterns().
+  std::vector<FunctionMatcher> matchers{};
+
+  /// Compile \p patterns into \p matchers. Returns false (and populates
+  /// \p error) if any pattern is invalid.
+  bool compilePatterns(std::string &error);
+
   /// Tells whether \p function is matched by \p patterns.
+  ///
+  /// This does not consult any cache; passes should prefer going through the
+  /// module's `FunctionSelection` instead.
   bool shouldRunOnFunction(llvm::Function const &function) const;
 };
 
@@ -10,11 +10,75 @@
 #ifndef LIMONCELLO_PASS_ARITHMETICMANGLER_H
 #define LIMONCELLO_PASS_ARITHMETICMANGLER_H
 
+#include "Limoncello/Support/MBAIdentity.h"
+
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstVisitor.h>
 #include <llvm/IR/NoFolder.h>
 #include <llvm/IR/PassManager.h>
 
+class FunctionCostModel;
+
+/// Cache of the binary operations created while mangling, used to share
+/// identical subexpressions rather than computing them again.
+///
+/// Commutative operations are looked up regardless of their operand order.
+class ExpressionCache {
+  using Key = std::tuple<unsigned, llvm::Value *, llvm::Value *>;
+  llvm::DenseMap<Key, llvm::Instruction *> m_expressions;
+
+  static Key getKey(unsigned opcode, llvm::Value *lhs, llvm::Value *rhs);
+  static Key getKey(llvm::Instruction const &inst);
+
+  /// Remove \p inst from the cache, if it is there.
+  void erase(llvm::Instruction &inst);
+
+public:
+  /// Get an existing operation equivalent to \p opcode applied to \p lhs and
+  /// \p rhs which can be used right before \p insertPoint, if there is one.
+  llvm::Instruction *lookup(unsigned opcode, llvm::Value *lhs,
+                            llvm::Value *rhs,
+                            llvm::Instruction const *insertPoint) const;
+
+  /// Make \p inst available for sharing, if it is a binary operation.
+  void insert(llvm::Instruction &inst);
+
+  /// Replace all uses of \p inst with \p replacement, keeping the cache up to
+  /// date as the users of \p inst change operands.
+  void replace(llvm::Instruction &inst, llvm::Instruction &replacement);
+};
+
+/// Picks the identity each operation is rewritten with.
+///
+/// Of the identities made up of at least \p strength instructions (or the
+/// largest ones, if there are none that large), those which are cheapest on
+/// the target are used; ties are broken at random.
+class IdentitySelector {
+  llvm::TargetTransformInfo const &m_tti;
+  unsigned m_strength;
+
+  /// Cheapest identities for each opcode and type seen so far.
+  llvm::DenseMap<std::pair<unsigned, llvm::Type *>,
+                 llvm::SmallVector<MBAIdentity const *>>
+      m_candidates;
+
+  /// Get the cheapest identities for \p opcode over values of \p type.
+  llvm::SmallVector<MBAIdentity const *> const &
+  getCandidates(unsigned opcode, llvm::Type *type);
+
+public:
+  IdentitySelector(llvm::TargetTransformInfo const &tti, unsigned strength);
+
+  /// Check whether there is any identity to rewrite \p opcode over values of
+  /// the given \p type with, without drawing on the random stream.
+  bool canSelect(unsigned opcode, llvm::Type *type);
+
+  /// Get an identity to rewrite \p opcode over values of the given \p type
+  /// with, or null if there are none.
+  MBAIdentity const *select(unsigned opcode, llvm::Type *type);
+};
+
 /// Instruction visitor which mangles arithmetic expressions.
 ///
 /// The visit functions will return a new (top-level) instruction if the
@@ -34,19 +98,29 @@ class ManglingVisitor
   /// optimizer is even invoked.
   llvm::IRBuilder<llvm::NoFolder> m_builder;
 
+  /// Source of the identities to rewrite operations with.
+  IdentitySelector &m_selector;
+
+  /// Subexpressions to share, if any.
+  ExpressionCache *m_cache;
+
+  /// Create (or reuse) the operation \p opcode between \p lhs and \p rhs.
+  llvm::Value *createBinOp(llvm::Instruction::BinaryOps opcode,
+                           llvm::Value *lhs, llvm::Value *rhs);
+
 public:
-  explicit ManglingVisitor(llvm::BasicBlock *block);
+  /// Create a visitor inserting into \p block, which rewrites operations with
+  /// identities from \p selector and shares subexpressions through \p cache
+  /// if one is given.
+  ManglingVisitor(llvm::BasicBlock *block, IdentitySelector &selector,
+                  ExpressionCache *cache = nullptr);
 
   /// Set the insertion point of the internal IR builder.
   ///
   /// This should be called every time a new instruction is inspected.
   void setInsertPoint(llvm::Instruction *inst);
 
-  llvm::Instruction *visitAdd(llvm::BinaryOperator &addOp);
-  llvm::Instruction *visitSub(llvm::BinaryOperator &subOp);
-  llvm::Instruction *visitAnd(llvm::BinaryOperator &andOp);
-  llvm::Instruction *visitOr(llvm::BinaryOperator &orOp);
-  llvm::Instruction *visitXor(llvm::BinaryOperator &xorOp);
+  llvm::Instruction *visitBinaryOperator(llvm::BinaryOperator &op);
 
   static llvm::Instruction *visitInstruction(llvm::Instruction &) {
     return nullptr;
@@ -66,12 +140,42 @@ class ArithmeticManglerPass
                                             llvm::BinaryOperator *binaryOp,
                                             llvm::Value *lhs, llvm::Value *rhs);
 
+  /// Mangle each of \p operations (and the operations their replacements are
+  /// made of) over up to \p rounds rounds, picking identities based on
+  /// \p tti.
+  ///
+  /// If \p budget is non-zero, no operation is expanded to more than that many
+  /// instructions and subexpressions are shared across rounds.
+  ///
+  /// If given, \p tryCharge is called on each of \p operations right before
+  /// it is first rewritten, and the operation is left alone if it returns
+  /// false. Returns the number of \p operations rewritten.
+  static unsigned
+  mangleOperations(llvm::ArrayRef<llvm::Instruction *> operations,
+                   llvm::TargetTransformInfo const &tti, int rounds,
+                   unsigned budget,
+                   llvm::function_ref<bool(llvm::Instruction &)> tryCharge =
+                       nullptr);
+
   /// Replace all (obfuscatable) arithmetic expressions in \p func with calls
-  /// to generated mixed boolean-arithmetic stub functions.
+  /// to generated mixed boolean-arithmetic stub functions, as far as
+  /// \p costModel allows mangling them over \p rounds rounds.
   ///
   /// Any stub functions created will be inserted into \p stubs.
   static void insertStubs(llvm::Function &func,
-                          std::vector<llvm::Function *> &stubs);
+                          std::vector<llvm::Function *> &stubs,
+                          FunctionCostModel &costModel, int rounds);
+
+  /// Replace all (obfuscatable) arithmetic expressions in \p func with mixed
+  /// boolean-arithmetic expressions directly (over \p rounds rounds), without
+  /// the use of stubs, as far as \p costModel allows.
+  ///
+  /// The resulting expressions are the same as would be produced by inlining
+  /// the stubs created by insertStubs() after mangling them. Returns the
+  /// number of operations mangled.
+  static unsigned mangleInPlace(llvm::Function &func,
+                                llvm::TargetTransformInfo const &tti,
+                                FunctionCostModel &costModel, int rounds);
 
 public:
   static llvm::PreservedAnalyses run(llvm::Module &module,
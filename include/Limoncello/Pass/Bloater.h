@@ -10,19 +10,42 @@
 #ifndef LIMONCELLO_PASS_BLOATER_H
 #define LIMONCELLO_PASS_BLOATER_H
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/PassManager.h>
 
+class FunctionCostModel;
+
 /// Pass for performing function bloating.
 class BloaterPass : public llvm::PassInfoMixin<BloaterPass> {
+  /// Map from the blocks ending in a candidate branch to their index.
+  using BranchIndexMap = llvm::DenseMap<llvm::BasicBlock *, unsigned>;
+
   /// Get the opaque global variable used by the bloater.
   static llvm::Constant *getOpaqueGlobal(llvm::Module &module);
 
   /// Get the opaque "always true" function.
   static llvm::Function *getOpaqueTrueFunction(llvm::Module &module);
 
+  /// Get a 64-bit value to evaluate an inline opaque predicate over at the end
+  /// of \p block; either a value computed in \p block, or the opaque global.
+  static llvm::Value *getPredicateOperand(llvm::IRBuilder<> &builder,
+                                          llvm::BasicBlock *block);
+
   /// Perform bloating on a function. Does NOT leave the function in a sound
   /// state, i.e. SSA repairs, etc. will still need to be done after.
-  static void bloatFunction(llvm::Function &func);
+  ///
+  /// Each branch is bloated with a \p probability percent chance, as far as
+  /// \p costModel allows (and if the dispatch profile doesn't mark it hot);
+  /// returns how many were.
+  ///
+  /// Only the branches in \p branchIndices (those the function had before
+  /// bloating started) are considered. The dispatch point in front of each is
+  /// numbered by its branch index, offset by \p firstPointIndex.
+  static unsigned bloatFunction(llvm::Function &func,
+                                FunctionCostModel &costModel, int probability,
+                                BranchIndexMap const &branchIndices,
+                                unsigned firstPointIndex);
 
 public:
   static llvm::PreservedAnalyses run(llvm::Module &module,
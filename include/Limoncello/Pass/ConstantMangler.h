@@ -10,15 +10,44 @@
 #ifndef LIMONCELLO_PASS_CONSTANTMANGLER_H
 #define LIMONCELLO_PASS_CONSTANTMANGLER_H
 
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/PassManager.h>
 
+namespace llvm {
+class LoopInfo;
+}
+
+class FunctionCostModel;
+
 class ConstantManglerPass : public llvm::PassInfoMixin<ConstantManglerPass> {
   /// Indicates if an instruction can be descended into and have it's operands
   /// modified as part of this pass.
   static bool canMangleInstruction(llvm::Instruction const &insn);
 
-  /// Mangle all of the constants in \p func.
-  static bool mangleFunctionConstants(llvm::Function &func);
+  /// Opaque values which have already been loaded (or truncated), by the
+  /// point they were loaded at and their type.
+  using OpaqueValueMap =
+      llvm::DenseMap<std::pair<llvm::Instruction *, llvm::Type *>,
+                     llvm::Value *>;
+
+  /// Get the instruction before which the opaque value used to mangle the
+  /// constants of \p inst should be loaded, per the configured scope.
+  ///
+  /// The \p loops of the function are only needed for loop scope.
+  static llvm::Instruction *getOpaqueLoadPoint(llvm::Instruction &inst,
+                                               llvm::LoopInfo const *loops);
+
+  /// Get the opaque value as a \p type, loading it (and truncating it) right
+  /// before \p loadPoint unless that has already been done.
+  static llvm::Value *getOpaqueValue(llvm::Constant *opaqueGlobal,
+                                     llvm::Instruction *loadPoint,
+                                     llvm::Type *type, OpaqueValueMap &values);
+
+  /// Mangle the constants in \p func, as far as \p costModel allows;
+  /// returns how many were.
+  static unsigned mangleFunctionConstants(llvm::Function &func,
+                                          FunctionCostModel &costModel,
+                                          llvm::LoopInfo const *loops);
 
 public:
   static llvm::PreservedAnalyses run(llvm::Module &module,
@@ -0,0 +1,35 @@
+//===-- Pass/DispatchProfiler.h - Dispatch profile runtime ----------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_PASS_DISPATCHPROFILER_H
+#define LIMONCELLO_PASS_DISPATCHPROFILER_H
+
+#include <llvm/IR/PassManager.h>
+
+/// Pass which gathers the counters of all dispatch points instrumented so far
+/// (see `Support/DispatchProfile.h`) into a single table, and appends the
+/// table to the configured profile when the program exits.
+///
+/// This needs to run after the last pass adding dispatch points.
+class DispatchProfilerPass : public llvm::PassInfoMixin<DispatchProfilerPass> {
+  /// Create the function writing a chunk made up of \p header, \p points and
+  /// \p counters (which hold \p numPoints points) to the profile.
+  static llvm::Function *createDumpFunction(llvm::Module &module,
+                                            llvm::GlobalVariable *header,
+                                            llvm::GlobalVariable *points,
+                                            llvm::GlobalVariable *counters,
+                                            uint64_t numPoints);
+
+public:
+  static llvm::PreservedAnalyses run(llvm::Module &module,
+                                     llvm::ModuleAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+#endif
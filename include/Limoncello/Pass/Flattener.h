@@ -10,9 +10,13 @@
 #ifndef LIMONCELLO_PASS_FLATTENER_H
 #define LIMONCELLO_PASS_FLATTENER_H
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/PassManager.h>
 
+#include <vector>
+
 /// Intermediary "state machine" structure used to simplify the control flow
 /// flattening process.
 class StateMachine {
@@ -23,15 +27,60 @@ class StateMachine {
   llvm::BasicBlock *m_defaultBlock = nullptr;
   llvm::BasicBlock *m_endBlock = nullptr;
 
+  /// State IDs to hand out, in the order states are added.
+  std::vector<uint32_t> m_stateIds;
+
+  /// Lowest state ID; state IDs always form a dense range starting here.
+  uint32_t m_firstStateId = 0;
+
+  /// Table of block addresses indexed by state ID; only present when using
+  /// threaded dispatch.
+  llvm::GlobalVariable *m_jumpTable = nullptr;
+
+  /// State ID of each block added so far.
+  llvm::DenseMap<llvm::BasicBlock *, llvm::ConstantInt *> m_blockStateIds;
+
+  /// Local dispatcher of each block added as part of a region.
+  llvm::DenseMap<llvm::BasicBlock *, llvm::BasicBlock *> m_blockDispatchers;
+
   static bool shouldIgnoreTerminator(llvm::Instruction *instruction);
 
+  /// Assign the next state ID to \p block.
+  llvm::ConstantInt *assignStateId(llvm::BasicBlock *block);
+
+  /// Get the state ID assigned to \p block.
+  llvm::ConstantInt *getStateId(llvm::BasicBlock *block) const;
+
+  /// Get the dispatcher to branch to in order to reach \p block; this is the
+  /// block's region dispatcher if it has one, or the top-level one otherwise.
+  llvm::BasicBlock *getDispatcher(llvm::BasicBlock *block) const;
+
   void rewriteBlock(llvm::BasicBlock *block);
   void rewriteBranch(llvm::BranchInst *branchInst);
 
+  /// Create the table of block addresses used for threaded dispatch.
+  void createJumpTable();
+
+  /// Emit a transition to the state \p stateId, which is one of the states
+  /// of \p dests, at the end of the block \p builder is inserting into.
+  void createTransition(llvm::IRBuilder<> &builder, llvm::Value *stateId,
+                        llvm::ArrayRef<llvm::BasicBlock *> dests);
+
+  /// Remove the shared dispatcher blocks, once nothing branches to them.
+  void eraseDispatcher();
+
 public:
-  explicit StateMachine(llvm::BasicBlock *entryBlock);
+  /// Create a state machine with room for \p numStates states.
+  StateMachine(llvm::BasicBlock *entryBlock, unsigned numStates);
+
+  void addState(llvm::BasicBlock *block);
 
-  void addState(llvm::BasicBlock *block) const;
+  /// Add all of \p blocks as states, dispatched between by a local dispatcher
+  /// of their own rather than the top-level one.
+  ///
+  /// The top-level dispatcher only needs to pick the right region; branches
+  /// within a region (or to a single other region) skip it entirely.
+  void addRegion(llvm::ArrayRef<llvm::BasicBlock *> blocks);
   void finalize(llvm::BasicBlock *firstBlock,
                 llvm::SmallVector<llvm::BasicBlock *> const &flatteningSet);
 };
@@ -44,10 +93,31 @@ class FlattenerPass : public llvm::PassInfoMixin<FlattenerPass> {
   static llvm::SmallVector<llvm::BasicBlock *>
   getFlatteningSet(llvm::Function &func);
 
+  /// Partition \p flatteningSet into regions of (about) \p regionSize blocks
+  /// each, made up of dominator subtrees of \p func.
+  static llvm::SmallVector<llvm::SmallVector<llvm::BasicBlock *>>
+  getRegions(llvm::Function &func,
+             llvm::SmallVector<llvm::BasicBlock *> const &flatteningSet,
+             unsigned regionSize);
+
+  /// Get the instruction splitConditionalPart() splits \p block at, or null if
+  /// it leaves \p block alone.
+  static llvm::Instruction *getConditionalPartStart(llvm::BasicBlock *block);
+
   /// Remove the terminator from \p block, including the condition instruction
   /// if the terminator is a conditional branch.
   static BlockPair splitConditionalPart(llvm::BasicBlock *block);
 
+  /// Tells whether \p func is selected for flattening.
+  static bool shouldRunOnFunction(llvm::Function &func,
+                                  llvm::FunctionAnalysisManager &fam);
+
+  /// Tells whether flattening \p func fits in its overhead budget, charging
+  /// the budget for it if so, and setting \p reason to why not otherwise.
+  static bool canAffordFlattening(llvm::Function &func,
+                                  llvm::FunctionAnalysisManager &fam,
+                                  llvm::StringRef &reason);
+
 public:
   static llvm::PreservedAnalyses run(llvm::Function &func,
                                      llvm::FunctionAnalysisManager &);
@@ -0,0 +1,53 @@
+//===-- Pass/ParallelDriver.h - Split-module parallel obfuscation ---------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_PASS_PARALLELDRIVER_H
+#define LIMONCELLO_PASS_PARALLELDRIVER_H
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/IR/PassManager.h>
+
+#include <functional>
+
+using BuildPipelineCallback = std::function<void(llvm::ModulePassManager &)>;
+
+/// Pass which splits a module into partitions, runs an obfuscation pipeline on
+/// each partition concurrently (each in its own context), then links the
+/// results back into the original module.
+///
+/// Partitioning only depends on the number of partitions requested, and all
+/// passes draw random numbers from per-function streams, so the output does
+/// not depend on the number of threads used.
+class ParallelDriverPass : public llvm::PassInfoMixin<ParallelDriverPass> {
+  unsigned m_partitions;
+  unsigned m_threads;
+  BuildPipelineCallback m_buildPipeline;
+
+  /// Run the pipeline on the partition serialized in \p bitcode, returning the
+  /// resulting module (also serialized as bitcode).
+  ///
+  /// Diagnostics (including optimization remarks) are passed on to
+  /// \p parentContext, the context of the module being split.
+  llvm::SmallString<0>
+  obfuscatePartition(llvm::StringRef bitcode, llvm::StringRef identifier,
+                     llvm::LLVMContext &parentContext) const;
+
+  /// Erase all functions, globals, aliases, etc. from \p module.
+  static void clearModule(llvm::Module &module);
+
+public:
+  ParallelDriverPass(unsigned partitions, unsigned threads,
+                     BuildPipelineCallback buildPipeline);
+
+  llvm::PreservedAnalyses run(llvm::Module &module,
+                              llvm::ModuleAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+#endif
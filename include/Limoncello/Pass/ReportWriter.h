@@ -0,0 +1,30 @@
+//===-- Pass/ReportWriter.h - Obfuscation report output -------------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_PASS_REPORTWRITER_H
+#define LIMONCELLO_PASS_REPORTWRITER_H
+
+#include <llvm/IR/PassManager.h>
+
+#include <string>
+
+/// Pass which writes the report of what the obfuscation passes did to a
+/// module (see `Support/Report.h`) to a JSON file, once they have all run.
+class ReportWriterPass : public llvm::PassInfoMixin<ReportWriterPass> {
+  std::string m_path;
+
+public:
+  explicit ReportWriterPass(std::string path) : m_path(std::move(path)) {}
+
+  llvm::PreservedAnalyses run(llvm::Module &module,
+                              llvm::ModuleAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+#endif
@@ -10,13 +10,17 @@
 #ifndef LIMONCELLO_PASS_STRINGOBFUSCATOR_H
 #define LIMONCELLO_PASS_STRINGOBFUSCATOR_H
 
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/IR/PassManager.h>
 
+class FunctionSelection;
+
 /// Record of a string that has been obfuscated during this pass.
 class ObfuscatedStringRecord {
 public:
-  /// Global variable associated with the string.
-  llvm::GlobalVariable *handle;
+  /// Pointer to the string; either its own global variable, or its place in
+  /// the packed string table.
+  llvm::Constant *handle;
 
   /// The size of the string in bytes.
   size_t size;
@@ -26,29 +30,69 @@ public:
 
   // XXX: This exists purely to appease `clangd` when trying to construct these
   // in place during a call to `emplace_back`.
-  ObfuscatedStringRecord(llvm::GlobalVariable *handle, size_t size, uint8_t key)
+  ObfuscatedStringRecord(llvm::Constant *handle, size_t size, uint8_t key)
       : handle(handle), size(size), key(key) {}
 };
 
 class StringObfuscatorPass : public llvm::PassInfoMixin<StringObfuscatorPass> {
+  /// Get the deobfuscation routine from the runtime module for \p context.
+  ///
+  /// The runtime is only parsed once per context; the same function will be
+  /// returned for every module in \p context.
+  static llvm::Function *getRuntimeFunction(llvm::LLVMContext &context);
+
   /// Get a local copy of the deobfuscation routine.
   ///
-  /// Guaranteed to return a valid function (or panic).
+  /// Modules for the architecture the runtime was built for get the routine
+  /// picking the fastest kernel the CPU supports; all others get the portable
+  /// kernel alone. Guaranteed to return a valid function (or panic).
   static llvm::Function *getDeobfuscateFunction(llvm::Module &module);
 
   /// Create a function to deobfuscate all strings in \p records.
   static llvm::Function *createDeobfuscateAllFunction(
       llvm::Module &module, std::vector<ObfuscatedStringRecord> const &records);
 
+  /// Make \p module run \p deobfuscateAllFn on startup.
+  static void insertDeobfuscateAllCall(llvm::Module &module,
+                                       llvm::Function *deobfuscateAllFn);
+
+  /// Create the once-flag and accessors for a group of lazily-decrypted
+  /// \p records, and guard every one of their \p uses with an accessor call.
+  static void createLazyGroup(llvm::Module &module,
+                              llvm::ArrayRef<ObfuscatedStringRecord> records,
+                              llvm::ArrayRef<llvm::Use *> uses);
+
+  /// Set up on-first-use decryption for all of \p records that allow it.
+  ///
+  /// Returns the records which must still be decrypted eagerly, e.g. strings
+  /// referenced from the initializers of other globals.
+  static std::vector<ObfuscatedStringRecord>
+  insertLazyAccessors(llvm::Module &module,
+                      std::vector<ObfuscatedStringRecord> const &records);
+
   /// Create a new strings constant with the obfuscated version of \p content
   /// by XOR-ing each byte with \p key.
   static llvm::Constant *createObfuscatedString(llvm::LLVMContext &context,
                                                 llvm::StringRef content,
                                                 uint8_t key);
 
-  /// Obfuscate all globally-defined strings in \p module.
+  /// Move \p strings into a single table (page-aligned if so configured),
+  /// obfuscating each one along the way, and add a record for each of them to
+  /// \p records. Returns the size of the table in bytes (zero if there are no
+  /// strings to pack).
+  ///
+  /// Keeping every string in the same few pages keeps the number of pages
+  /// dirtied by decryption to a minimum.
+  static uint64_t packStrings(llvm::Module &module,
+                              llvm::ArrayRef<llvm::GlobalVariable *> strings,
+                              std::vector<ObfuscatedStringRecord> &records);
+
+  /// Obfuscate all globally-defined strings in \p module which are used by a
+  /// function the pass is configured to run on, setting \p tableSize to the
+  /// size of the table any of them were packed into.
   static std::vector<ObfuscatedStringRecord>
-  obfuscateStrings(llvm::Module &module);
+  obfuscateStrings(llvm::Module &module, FunctionSelection const &selection,
+                   uint64_t &tableSize);
 
 public:
   static llvm::PreservedAnalyses run(llvm::Module &module,
@@ -0,0 +1,98 @@
+//===-- Support/DispatchProfile.h - Dispatch point profiling --------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// Dispatch points are the places obfuscation routes control flow through at
+// runtime: the states of a flattened function, and the dispatch blocks the
+// bloater puts in front of branches. Instrumented builds count how often each
+// of them runs, and append the counts to a profile at exit.
+//
+// The profile is a sequence of chunks, one per instrumented module (and run),
+// in the byte order of the target:
+//
+//   uint64_t magic;     // DispatchProfileMagic
+//   uint64_t numPoints;
+//   struct { uint64_t function; uint32_t kind; uint32_t index; }
+//            points[numPoints];
+//   uint64_t counts[numPoints];
+//
+// Functions are identified by the hash of their name and of the source file of
+// their module (which tells apart `static` functions of the same name), so
+// that profiles stay valid as long as the code they were taken from does.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_SUPPORT_DISPATCHPROFILE_H
+#define LIMONCELLO_SUPPORT_DISPATCHPROFILE_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/IR/IRBuilder.h>
+
+#include <cstdint>
+#include <memory>
+#include <tuple>
+
+/// Magic value starting every chunk of a dispatch profile ("LMCODP01").
+constexpr uint64_t DispatchProfileMagic = 0x31305044434f4d4c;
+
+/// Named metadata listing the counters of a module's dispatch points until
+/// `DispatchProfilePass` gathers them into a table.
+constexpr auto DispatchPointsMetadataName = "limoncello.dispatch.points";
+
+/// Kinds of dispatch points, i.e. the passes adding them.
+enum class DispatchPointKind : uint32_t {
+  /// A state of a flattened function, numbered by its position in the set of
+  /// flattened blocks.
+  FlattenerState = 0,
+
+  /// A bloater dispatch block, numbered by the round it was added in and the
+  /// position of the branch it was put in front of among the function's
+  /// original branches.
+  BloaterDispatch = 1,
+};
+
+/// Count executions of dispatch point \p index of \p kind in the function
+/// \p builder is inserting into, at its insertion point.
+///
+/// The counter is only tied into the profile written at exit by
+/// `DispatchProfilePass`, which has to run after all passes adding points.
+void insertDispatchCounter(llvm::IRBuilder<> &builder, DispatchPointKind kind,
+                           unsigned index);
+
+/// Dispatch counts read back from a profile, summed over all of its chunks.
+class DispatchProfile {
+  using PointKey = std::tuple<uint32_t, uint64_t, uint32_t>;
+  using FunctionKey = std::pair<uint32_t, uint64_t>;
+
+  llvm::DenseSet<PointKey> m_hotPoints;
+  llvm::DenseSet<FunctionKey> m_hotFunctions;
+
+  /// Parse the profile in \p data, marking the hottest points (those making up
+  /// \p hotPercentile percent of all dispatches) as hot.
+  bool parse(llvm::StringRef data, unsigned hotPercentile);
+
+public:
+  /// Load the profile at \p path, returning null (after reporting why) if it
+  /// can't be read or is malformed.
+  static std::unique_ptr<DispatchProfile> load(llvm::StringRef path,
+                                               unsigned hotPercentile);
+
+  /// Get the profile named by the global config, loading it the first time;
+  /// returns null if there is none.
+  static DispatchProfile const *get();
+
+  /// Tells whether dispatch point \p index of \p kind in \p func is hot.
+  bool isHotPoint(DispatchPointKind kind, llvm::Function const &func,
+                  unsigned index) const;
+
+  /// Tells whether any dispatch point of \p kind in \p func is hot.
+  bool hasHotPoints(DispatchPointKind kind, llvm::Function const &func) const;
+};
+
+#endif
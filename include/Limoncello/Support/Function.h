@@ -35,6 +35,8 @@ llvm::Function *createStubFunction(llvm::Module &module, llvm::StringRef name,
 bool valueEscapesLocalBlock(llvm::Instruction &value);
 
 /// Perform repairs to the IR for \p func as to not break SSA rules.
-void repairSSA(llvm::Function &func);
+///
+/// Returns the number of values (registers and PHI nodes) demoted to the stack.
+unsigned repairSSA(llvm::Function &func);
 
 #endif
@@ -0,0 +1,59 @@
+//===-- Support/MBAIdentity.h - Mixed boolean-arithmetic identities -------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_SUPPORT_MBAIDENTITY_H
+#define LIMONCELLO_SUPPORT_MBAIDENTITY_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/IR/Instruction.h>
+
+/// Operand of a node in an identity which isn't another node; non-negative
+/// operands refer to an earlier node of the same identity by index.
+enum MBAOperand : int {
+  MBAOperandX = -1,
+  MBAOperandY = -2,
+  MBAOperandZero = -3,
+  MBAOperandOne = -4,
+  MBAOperandTwo = -5,
+  MBAOperandAllOnes = -6,
+};
+
+/// Single operation in the expression an identity rewrites to.
+struct MBANode {
+  llvm::Instruction::BinaryOps opcode;
+  int lhs;
+  int rhs;
+};
+
+/// Mixed boolean-arithmetic expression equivalent to a binary operation `x op
+/// y`, stored as a list of nodes in evaluation order; the last one is the
+/// result.
+struct MBAIdentity {
+  llvm::Instruction::BinaryOps opcode;
+  llvm::ArrayRef<MBANode> nodes;
+};
+
+/// Get every identity which can stand in for \p opcode.
+llvm::ArrayRef<MBAIdentity> getMBAIdentities(unsigned opcode);
+
+/// Get the number of nodes in the largest identity.
+unsigned getMaxMBAIdentitySize();
+
+/// Get the constant an \p operand of the given \p type stands for; \p operand
+/// must not be `MBAOperandX`, `MBAOperandY`, or a node.
+llvm::Constant *getMBAConstant(int operand, llvm::Type *type);
+
+/// Estimate what evaluating \p identity over values of the given \p type costs
+/// on the target described by \p tti, in reciprocal throughput.
+llvm::InstructionCost getMBAIdentityCost(MBAIdentity const &identity,
+                                         llvm::Type *type,
+                                         llvm::TargetTransformInfo const &tti);
+
+#endif
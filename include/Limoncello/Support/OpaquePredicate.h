@@ -0,0 +1,57 @@
+//===-- Support/OpaquePredicate.h - Inlinable opaque predicates -----------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_SUPPORT_OPAQUEPREDICATE_H
+#define LIMONCELLO_SUPPORT_OPAQUEPREDICATE_H
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Support/YAMLTraits.h>
+
+/// Kinds of predicates which always evaluate to true, but which the optimizer
+/// (and, ideally, a human) can't prove as much for.
+enum class OpaquePredicateKind {
+  /// A call to a function which can't be inlined or optimized; each pass using
+  /// this kind provides the function itself.
+  Call,
+
+  /// `x * (x + 1)` is even.
+  Parity,
+
+  /// `(x * (x + 1))^2` is a multiple of four.
+  SquareProduct,
+
+  /// `x^2 != 7 * y^2 - 1`, which holds since a square is 0, 1, or 4 (mod 8)
+  /// while the right-hand side is 3, 6, or 7 (mod 8).
+  Squares,
+};
+
+/// Get the number of instructions evaluating a predicate of the given \p kind
+/// adds, not counting the branch on its result.
+unsigned getOpaquePredicateCost(OpaquePredicateKind kind);
+
+/// Emit an inlinable opaque predicate of the given \p kind over \p x, which
+/// must be a 64-bit integer and must not be poison.
+///
+/// Returns an `i1` which is always true; \p kind can't be `Call`.
+llvm::Value *createOpaquePredicate(llvm::IRBuilder<> &builder,
+                                   OpaquePredicateKind kind, llvm::Value *x);
+
+template <>
+struct llvm::yaml::ScalarEnumerationTraits<OpaquePredicateKind> {
+  static void enumeration(IO &io, OpaquePredicateKind &kind) {
+    io.enumCase(kind, "call", OpaquePredicateKind::Call);
+    io.enumCase(kind, "parity", OpaquePredicateKind::Parity);
+    io.enumCase(kind, "square-product", OpaquePredicateKind::SquareProduct);
+    io.enumCase(kind, "squares", OpaquePredicateKind::Squares);
+  }
+};
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(OpaquePredicateKind)
+
+#endif
@@ -10,11 +10,33 @@
 #ifndef LIMONCELLO_SUPPORT_RANDOM_H
 #define LIMONCELLO_SUPPORT_RANDOM_H
 
+#include <llvm/ADT/StringRef.h>
+
 #include <cstdint>
+#include <random>
 
 /// Seed the backing random number generator.
 void setRandomSeed(unsigned seed);
 
+/// Makes the current thread draw random numbers from a substream derived only
+/// from the seed, the \p pass name, and the \p name of the function (or
+/// global) being obfuscated for as long as the scope is alive.
+///
+/// Passes should open one of these for every function (or global) they work
+/// on, so that the output does not depend on the order functions are visited
+/// in, or on which thread they are visited on.
+class RandomStreamScope {
+  std::mt19937 m_engine;
+  std::mt19937 *m_previous;
+
+public:
+  RandomStreamScope(llvm::StringRef pass, llvm::StringRef name);
+  ~RandomStreamScope();
+
+  RandomStreamScope(RandomStreamScope const &) = delete;
+  RandomStreamScope &operator=(RandomStreamScope const &) = delete;
+};
+
 /// Get a random 8-bit value.
 uint8_t getRandomInt8();
 
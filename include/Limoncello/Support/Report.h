@@ -0,0 +1,63 @@
+//===-- Support/Report.h - Obfuscation remarks and reports ----------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LIMONCELLO_SUPPORT_REPORT_H
+#define LIMONCELLO_SUPPORT_REPORT_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+#include <utility>
+
+namespace llvm {
+class Function;
+class OptimizationRemarkEmitter;
+class raw_ostream;
+} // namespace llvm
+
+/// Named count of something a pass did, e.g. `{"blocks", 12}`.
+using ReportCounter = std::pair<llvm::StringRef, uint64_t>;
+
+/// Start collecting a report of what the passes do, to be written out with
+/// writeReport() once they have run. Until this is called, passes only emit
+/// optimization remarks.
+void enableReport();
+
+/// Tells whether a report is being collected.
+bool isReportEnabled();
+
+/// Report that \p pass left \p func alone because of \p reason.
+void reportSkippedFunction(llvm::OptimizationRemarkEmitter &ore,
+                           char const *pass, llvm::Function const &func,
+                           llvm::StringRef reason);
+
+/// Report that \p pass obfuscated \p func, growing it from
+/// \p instructionsBefore to \p instructionsAfter instructions, with
+/// \p counters detailing what it did.
+void reportObfuscatedFunction(llvm::OptimizationRemarkEmitter &ore,
+                              char const *pass, llvm::Function const &func,
+                              uint64_t instructionsBefore,
+                              uint64_t instructionsAfter,
+                              llvm::ArrayRef<ReportCounter> counters = {});
+
+/// Report what \p pass did to a module as a whole (rather than to any single
+/// function), e.g. how many strings it encrypted.
+void reportModuleCounters(char const *pass,
+                          llvm::ArrayRef<ReportCounter> counters);
+
+/// Write the report collected so far as JSON, for the module built from
+/// \p sourceFile.
+void writeReport(llvm::raw_ostream &os, llvm::StringRef sourceFile);
+
+/// Discard the report collected so far, so that the next module run in the
+/// same process (e.g. under LTO) starts from an empty report.
+void clearReport();
+
+#endif
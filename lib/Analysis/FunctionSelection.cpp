@@ -0,0 +1,103 @@
+//===-- Analysis/FunctionSelection.cpp - Per-module pass selection cache --===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Analysis/FunctionSelection.h"
+
+#include "Limoncello/Config/Config.h"
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+FunctionSelection::FunctionSelection(Module &module) {
+  m_functions.reserve(module.size());
+  for (auto &func : module) {
+    m_indices[&func] = m_functions.size();
+    m_functions.emplace_back(&func);
+  }
+
+  auto &config = *Config::get();
+  forEachOverride(module, [&](Function &func, StringRef directives) {
+    std::string error;
+    if (!m_overrides[m_indices[&func]].parse(directives, config, error))
+      errs() << "Limoncello: Ignoring invalid override on " << func.getName()
+             << ": " << error << "\n";
+  });
+}
+
+std::optional<unsigned>
+FunctionSelection::getIndex(Function const &func) const {
+  // A new function may also have been allocated at the address of a deleted
+  // one, which the value handle (now null) tells apart.
+  auto index = m_indices.find(&func);
+  if (index == m_indices.end() || m_functions[index->second] != &func)
+    return std::nullopt;
+
+  return index->second;
+}
+
+BitVector const &
+FunctionSelection::getDecisions(PassConfig const &config) const {
+  auto [it, inserted] = m_decisions.try_emplace(&config);
+  if (!inserted)
+    return it->second;
+
+  auto &decisions = it->second;
+  decisions.resize(m_functions.size());
+  for (unsigned i = 0; i < m_functions.size(); ++i) {
+    auto func = cast_or_null<Function>(m_functions[i]);
+    if (func && config.shouldRunOnFunction(*func))
+      decisions.set(i);
+  }
+
+  for (auto const &[index, entry] : m_overrides) {
+    if (entry.isPassDisabled(config))
+      decisions.reset(index);
+  }
+
+  return decisions;
+}
+
+bool FunctionSelection::shouldRunOnFunction(PassConfig const &config,
+                                            Function const &func) const {
+  if (!config.isEnabled)
+    return false;
+
+  // Functions created after the analysis ran need to be matched directly.
+  auto index = getIndex(func);
+  if (!index)
+    return config.shouldRunOnFunction(func);
+
+  return getDecisions(config).test(*index);
+}
+
+FunctionOverride const *
+FunctionSelection::getOverride(Function const &func) const {
+  auto index = getIndex(func);
+  if (!index)
+    return nullptr;
+
+  auto entry = m_overrides.find(*index);
+  return entry != m_overrides.end() ? &entry->second : nullptr;
+}
+
+bool FunctionSelection::hasOptOuts(PassConfig const &config) const {
+  return any_of(m_overrides, [&](auto const &entry) {
+    return entry.second.isPassDisabled(config);
+  });
+}
+
+AnalysisKey FunctionSelectionAnalysis::Key;
+
+FunctionSelection FunctionSelectionAnalysis::run(Module &module,
+                                                 ModuleAnalysisManager &) {
+  return FunctionSelection(module);
+}
+
@@ -0,0 +1,148 @@
+//===-- Analysis/ObfuscationCost.cpp - Hotness-aware obfuscation budget ---===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Analysis/ObfuscationCost.h"
+
+#include "Limoncello/Config/Config.h"
+
+#include <llvm/Analysis/BlockFrequencyInfo.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/IR/Module.h>
+
+using namespace llvm;
+
+/// Maximum number of predecessors to walk through when looking for the block
+/// a new block was split off from.
+constexpr auto MaxLookupDepth = 8;
+
+FunctionCostModel::FunctionCostModel(Function const &func,
+                                     BlockFrequencyInfo &bfi,
+                                     ProfileSummaryInfo const *psi,
+                                     OverheadBudget &budget)
+    : m_budget(&budget) {
+  auto const &config = Config::get()->hotness;
+  bool hasProfile = psi && psi->hasProfileSummary();
+
+  // Frequencies are snapshotted up front, since passes will be adding blocks
+  // (which the frequency info knows nothing about) while using the model.
+  auto entryFreq = std::max<uint64_t>(bfi.getEntryFreq(), 1);
+  for (auto &block : func) {
+    auto blockFreq = bfi.getBlockFreq(&block).getFrequency();
+    auto frequency =
+        static_cast<double>(blockFreq) / static_cast<double>(entryFreq);
+    bool isHot = hasProfile ? psi->isHotBlock(&block, &bfi)
+                            : frequency >= config.hotBlockFrequency;
+
+    m_blocks[&block] = {frequency, isHot};
+  }
+
+  if (hasProfile && config.skipHotFunctions) {
+    m_isHot = psi->isFunctionEntryHot(&func) ||
+              psi->isFunctionHotInCallGraph(&func, bfi);
+  }
+}
+
+FunctionCostModel::BlockInfo const *
+FunctionCostModel::lookup(BasicBlock const &block) const {
+  auto current = &block;
+  for (int i = 0; current && i < MaxLookupDepth; ++i) {
+    auto it = m_blocks.find(current);
+    if (it != m_blocks.end())
+      return &it->second;
+
+    current = current->getSinglePredecessor();
+  }
+
+  return nullptr;
+}
+
+bool FunctionCostModel::isBlockHot(BasicBlock const &block) const {
+  auto info = lookup(block);
+  return info && info->isHot;
+}
+
+double FunctionCostModel::getRelativeFrequency(BasicBlock const &block) const {
+  // Blocks of unknown origin are assumed to run once per call.
+  auto info = lookup(block);
+  return info ? info->frequency : 1.0;
+}
+
+double FunctionCostModel::getEstimatedInstructionCount() const {
+  double count = 0;
+  for (auto [block, info] : m_blocks)
+    count += info.frequency * block->sizeWithoutDebug();
+
+  return count;
+}
+
+bool FunctionCostModel::trySpend(BasicBlock const &block, double cost) {
+  if (!m_budget)
+    return true;
+  if (isBlockHot(block))
+    return false;
+
+  return trySpend(cost * getRelativeFrequency(block));
+}
+
+bool FunctionCostModel::trySpend(double cost) {
+  if (!m_budget)
+    return true;
+  if (m_budget->spent + cost > m_budget->limit)
+    return false;
+
+  m_budget->spent += cost;
+  return true;
+}
+
+FunctionCostModel
+ObfuscationCost::getModel(Function &func, BlockFrequencyInfo &bfi,
+                          ProfileSummaryInfo const *psi) const {
+  // A function which happens to have been allocated at the address of a
+  // deleted one starts over with a fresh budget.
+  auto &budget = m_budgets[&func];
+  bool isNew = budget.function != &func;
+  if (isNew)
+    budget = {&func, 0, 0};
+
+  FunctionCostModel model(func, bfi, psi, budget);
+
+  // The budget is relative to the function as it was first seen, i.e. before
+  // any pass added overhead to it.
+  if (isNew) {
+    budget.limit = model.getEstimatedInstructionCount() *
+                   Config::get()->hotness.budget / 100.0;
+  }
+
+  return model;
+}
+
+FunctionCostModel ObfuscationCost::getModel(Function &func,
+                                            ModuleAnalysisManager &mam) const {
+  if (!Config::get()->hotness.isEnabled || func.isDeclaration())
+    return {};
+
+  auto &module = *func.getParent();
+  auto &fam =
+      mam.getResult<FunctionAnalysisManagerModuleProxy>(module).getManager();
+  return getModel(func, fam.getResult<BlockFrequencyAnalysis>(func),
+                  &mam.getResult<ProfileSummaryAnalysis>(module));
+}
+
+FunctionCostModel
+ObfuscationCost::getModel(Function &func, FunctionAnalysisManager &fam) const {
+  if (!Config::get()->hotness.isEnabled || func.isDeclaration())
+    return {};
+
+  auto &moduleProxy = fam.getResult<ModuleAnalysisManagerFunctionProxy>(func);
+  auto psi =
+      moduleProxy.getCachedResult<ProfileSummaryAnalysis>(*func.getParent());
+  return getModel(func, fam.getResult<BlockFrequencyAnalysis>(func), psi);
+}
+
+AnalysisKey ObfuscationCostAnalysis::Key;
@@ -9,12 +9,16 @@
 
 #include "Limoncello/Config/Config.h"
 
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/raw_ostream.h>
+
 #include <fstream>
 #include <sstream>
 
 using namespace llvm;
 
-Config::Config() : isValid(true), debug(false), seed(0) {}
+Config::Config()
+    : isValid(true), debug(false), seed(0), partitions(0), threads(0) {}
 
 Config::Config(std::string const &path) : Config() {
   std::string yaml;
@@ -34,8 +38,47 @@ void Config::loadFromYAML(std::string const &yaml) {
   yaml::Input yamlParser(yaml);
   yamlParser >> *this;
 
-  if (yamlParser.error())
+  if (yamlParser.error()) {
     isValid = false;
+    return;
+  }
+
+  // Patterns are compiled once up front, both so that matching functions is
+  // cheap later and so that invalid patterns are reported immediately rather
+  // than silently never matching.
+  for (auto passConfig : getPassConfigs()) {
+    std::string error;
+    if (!passConfig->compilePatterns(error)) {
+      errs() << "Limoncello: " << error << "\n";
+      isValid = false;
+    }
+  }
+
+  // Passes can be moved later into the pipeline, but not past each other.
+  auto previous = ExtensionPoint::PipelineStart;
+  for (auto passConfig : getPassConfigs()) {
+    if (!passConfig->isEnabled)
+      continue;
+
+    if (passConfig->extensionPoint < previous) {
+      errs() << "Limoncello: Passes must be placed at extension points in "
+                "pipeline order\n";
+      isValid = false;
+      break;
+    }
+
+    previous = passConfig->extensionPoint;
+  }
+}
+
+PassConfig *Config::getPassConfig(StringRef name) {
+  return StringSwitch<PassConfig *>(name)
+      .Case("arithmetic-mangler", &arithmeticMangler)
+      .Case("bloater", &bloater)
+      .Case("constant-mangler", &constantMangler)
+      .Case("flattener", &flattener)
+      .Case("string-obfuscator", &stringObfuscator)
+      .Default(nullptr);
 }
 
 static Config *g_config = nullptr;
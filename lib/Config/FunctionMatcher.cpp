@@ -0,0 +1,170 @@
+//===-- Config/FunctionMatcher.cpp - Precompiled function name pattern ----===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Config/FunctionMatcher.h"
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/ErrorHandling.h>
+
+using namespace llvm;
+
+/// Tells whether \p c has special meaning in a (POSIX extended) regex.
+static bool isRegexMetacharacter(char c) {
+  return StringRef(".[]()*+?{}|^$\\").contains(c);
+}
+
+FunctionMatcher::FunctionMatcher(StringRef pattern) {
+  // As a cheap hack, let patterns be negated by prepending a tilde; since this
+  // isn't actually valid regex, we'll need to note that the pattern should be
+  // negated, then drop the tilde.
+  m_isNegated = pattern.consume_front("~");
+
+  if (parseGlob(pattern))
+    return;
+
+  m_kind = Kind::Regex;
+  m_regex = std::make_shared<Regex>(pattern);
+}
+
+bool FunctionMatcher::parseGlob(StringRef body) {
+  bool isAnchoredStart = body.consume_front("^");
+  bool isAnchoredEnd = false;
+  if (body.endswith("$")) {
+    // An escaped dollar sign at the end is a literal, but it isn't worth the
+    // trouble to handle this case here.
+    if (body.endswith("\\$"))
+      return false;
+
+    body = body.drop_back();
+    isAnchoredEnd = true;
+  }
+
+  SmallVector<std::string, 2> segments(1);
+  for (size_t i = 0; i < body.size(); ++i) {
+    auto c = body[i];
+    if (c == '.' && i + 1 < body.size() && body[i + 1] == '*') {
+      segments.emplace_back();
+      ++i;
+      continue;
+    }
+
+    // Escaped metacharacters are just literals; any other escape sequence is
+    // a character class (or similar) and needs the real regex engine.
+    if (c == '\\') {
+      if (i + 1 >= body.size() || !isRegexMetacharacter(body[i + 1]))
+        return false;
+
+      segments.back() += body[++i];
+      continue;
+    }
+
+    if (isRegexMetacharacter(c))
+      return false;
+
+    segments.back() += c;
+  }
+
+  // A leading or trailing wildcard makes the corresponding anchor moot; after
+  // accounting for that, empty segments carry no information.
+  if (segments.size() > 1) {
+    if (segments.front().empty())
+      isAnchoredStart = false;
+    if (segments.back().empty())
+      isAnchoredEnd = false;
+  }
+
+  bool isEmptyExact =
+      segments.size() == 1 && isAnchoredStart && isAnchoredEnd;
+  llvm::erase_if(segments, [](auto const &s) { return s.empty(); });
+
+  m_isAnchoredStart = isAnchoredStart;
+  m_isAnchoredEnd = isAnchoredEnd;
+
+  if (segments.empty()) {
+    if (isEmptyExact) {
+      m_kind = Kind::Exact;
+      m_segments.emplace_back();
+    } else {
+      m_kind = Kind::Any;
+    }
+
+    return true;
+  }
+
+  if (segments.size() == 1) {
+    if (isAnchoredStart && isAnchoredEnd)
+      m_kind = Kind::Exact;
+    else if (isAnchoredStart)
+      m_kind = Kind::Prefix;
+    else if (isAnchoredEnd)
+      m_kind = Kind::Suffix;
+    else
+      m_kind = Kind::Substring;
+  } else {
+    m_kind = Kind::Glob;
+  }
+
+  m_segments = std::move(segments);
+  return true;
+}
+
+bool FunctionMatcher::isValid(std::string &error) const {
+  if (m_kind != Kind::Regex)
+    return true;
+
+  return m_regex->isValid(error);
+}
+
+bool FunctionMatcher::matchesGlob(StringRef name) const {
+  ArrayRef<std::string> segments = m_segments;
+  if (m_isAnchoredStart) {
+    if (!name.consume_front(segments.front()))
+      return false;
+    segments = segments.drop_front();
+  }
+  if (m_isAnchoredEnd) {
+    if (!name.consume_back(segments.back()))
+      return false;
+    segments = segments.drop_back();
+  }
+
+  // Taking the leftmost occurrence of each segment is always safe, since it
+  // leaves the most room for the segments that follow.
+  for (auto const &segment : segments) {
+    auto index = name.find(segment);
+    if (index == StringRef::npos)
+      return false;
+
+    name = name.drop_front(index + segment.size());
+  }
+
+  return true;
+}
+
+bool FunctionMatcher::matches(StringRef name) const {
+  switch (m_kind) {
+  case Kind::Any:
+    return true;
+  case Kind::Exact:
+    return name == m_segments.front();
+  case Kind::Prefix:
+    return name.startswith(m_segments.front());
+  case Kind::Suffix:
+    return name.endswith(m_segments.front());
+  case Kind::Substring:
+    return name.contains(m_segments.front());
+  case Kind::Glob:
+    return matchesGlob(name);
+  case Kind::Regex:
+    return m_regex->match(name);
+  }
+
+  llvm_unreachable("Unhandled function matcher kind");
+}
@@ -0,0 +1,131 @@
+//===-- Config/FunctionOverride.cpp - Per-function config overrides -------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Config/FunctionOverride.h"
+
+#include "Limoncello/Config/Config.h"
+
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Module.h>
+
+using namespace llvm;
+
+bool FunctionOverride::parse(StringRef directives, Config &config,
+                             std::string &error) {
+  SmallVector<StringRef> parts;
+  directives.split(parts, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+
+  bool isValid = true;
+  auto fail = [&](Twine const &message) {
+    if (isValid)
+      error = message.str();
+    isValid = false;
+  };
+
+  for (auto part : parts) {
+    auto directive = part.trim();
+
+    if (directive == "none") {
+      for (auto passConfig : config.getPassConfigs())
+        disabledPasses.emplace_back(passConfig);
+      continue;
+    }
+
+    if (directive.consume_front("no-")) {
+      if (auto passConfig = config.getPassConfig(directive))
+        disabledPasses.emplace_back(passConfig);
+      else
+        fail("unknown pass '" + directive + "'");
+      continue;
+    }
+
+    auto [key, valueText] = directive.split('=');
+    auto option = StringSwitch<std::optional<int> *>(key.trim())
+                      .Case("bloater.rounds", &bloaterRounds)
+                      .Case("bloater.probability", &bloaterProbability)
+                      .Case("arithmetic-mangler.rounds",
+                            &arithmeticManglerRounds)
+                      .Default(nullptr);
+    if (!option) {
+      fail("unknown directive '" + directive + "'");
+      continue;
+    }
+
+    int value;
+    if (valueText.trim().getAsInteger(10, value) || value < 0 ||
+        (option == &bloaterProbability && value > 100)) {
+      fail("invalid value for '" + key.trim() + "'");
+      continue;
+    }
+
+    *option = value;
+  }
+
+  return isValid;
+}
+
+bool FunctionOverride::isPassDisabled(PassConfig const &config) const {
+  return is_contained(disabledPasses, &config);
+}
+
+/// Call \p callback with the directives of each override annotation in
+/// \p module, along with the function it is attached to.
+static void
+forEachAnnotation(Module &module,
+                  function_ref<void(Function &, StringRef)> callback) {
+  // Annotations are kept in a global array of `{ptr value, ptr annotation,
+  // ptr file, i32 line, ptr arguments}` structs.
+  auto annotations = module.getNamedGlobal("llvm.global.annotations");
+  if (!annotations || !annotations->hasInitializer())
+    return;
+
+  auto entries = dyn_cast<ConstantArray>(annotations->getInitializer());
+  if (!entries)
+    return;
+
+  for (auto &entry : entries->operands()) {
+    auto fields = dyn_cast<ConstantStruct>(entry);
+    if (!fields || fields->getNumOperands() < 2)
+      continue;
+
+    auto func = dyn_cast<Function>(fields->getOperand(0)->stripPointerCasts());
+    StringRef annotation;
+    if (!func || !getConstantStringInfo(fields->getOperand(1), annotation))
+      continue;
+
+    if (annotation.consume_front(OverrideAnnotationPrefix))
+      callback(*func, annotation);
+  }
+}
+
+void forEachOverride(Module &module,
+                     function_ref<void(Function &, StringRef)> callback) {
+  for (auto &func : module) {
+    if (func.hasFnAttribute(OverrideAttributeName))
+      callback(func,
+               func.getFnAttribute(OverrideAttributeName).getValueAsString());
+  }
+
+  forEachAnnotation(module, callback);
+}
+
+void copyOverrideAnnotationsToAttributes(Module &module) {
+  forEachAnnotation(module, [](Function &func, StringRef directives) {
+    std::string value = directives.str();
+    if (func.hasFnAttribute(OverrideAttributeName)) {
+      auto existing =
+          func.getFnAttribute(OverrideAttributeName).getValueAsString();
+      value = (existing + "," + directives).str();
+    }
+
+    func.addFnAttr(OverrideAttributeName, value);
+  });
+}
@@ -9,81 +9,205 @@
 
 #include "Limoncello/Pass/ArithmeticMangler.h"
 
+#include "Limoncello/Analysis/FunctionSelection.h"
+#include "Limoncello/Analysis/ObfuscationCost.h"
 #include "Limoncello/Config/Config.h"
 #include "Limoncello/Support/Function.h"
+#include "Limoncello/Support/Random.h"
+#include "Limoncello/Support/Report.h"
 
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/OptimizationRemarkEmitter.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/InstVisitor.h>
 #include <llvm/IR/NoFolder.h>
-#include <llvm/IR/PatternMatch.h>
+
+#include <cmath>
+#include <optional>
+
+#define DEBUG_TYPE "arithmetic-mangler"
+
+STATISTIC(NumFunctionsMangled, "Number of functions with arithmetic mangled");
+STATISTIC(NumFunctionsSkipped, "Number of functions not mangled");
+STATISTIC(NumOperationsMangled, "Number of operations mangled");
+STATISTIC(NumStubsCreated, "Number of MBA stub functions created");
+STATISTIC(NumInstructionsAdded,
+          "Number of instructions added, including those of stubs");
 
 using namespace llvm;
 
-// TOOD: Replace this with template magic.
-#define MATCH(Op, PredicateFn, Lhs, Rhs)                                       \
-  (PatternMatch::match(Op, PredicateFn(PatternMatch::m_Value(Lhs),             \
-                                       PatternMatch::m_Value(Rhs))))
+/// Estimate the number of instructions added by mangling a single operation
+/// over \p rounds rounds; each round turns every operation into roughly four,
+/// unless a \p budget caps the total.
+static double getManglingCost(int rounds, unsigned budget) {
+  auto cost = std::pow(4.0, std::max(rounds, 0)) - 1;
+  return budget ? std::min<double>(cost, budget - 1) : cost;
+}
 
-ManglingVisitor::ManglingVisitor(BasicBlock *block)
-    : m_builder(IRBuilder<NoFolder>(block)) {}
+ExpressionCache::Key ExpressionCache::getKey(unsigned opcode, Value *lhs,
+                                             Value *rhs) {
+  if (Instruction::isCommutative(opcode) && std::less<>()(rhs, lhs))
+    std::swap(lhs, rhs);
 
-void ManglingVisitor::setInsertPoint(Instruction *inst) {
-  m_builder.SetInsertPoint(inst);
+  return {opcode, lhs, rhs};
 }
 
-Instruction *ManglingVisitor::visitAdd(BinaryOperator &addOp) {
-  Value *lhs, *rhs;
-  if (!MATCH(&addOp, PatternMatch::m_Add, lhs, rhs)) {
-    return nullptr;
-  }
+ExpressionCache::Key ExpressionCache::getKey(Instruction const &inst) {
+  return getKey(inst.getOpcode(), inst.getOperand(0), inst.getOperand(1));
+}
 
-  return BinaryOperator::CreateAdd(m_builder.CreateAnd(lhs, rhs),
-                                   m_builder.CreateOr(lhs, rhs));
+void ExpressionCache::erase(Instruction &inst) {
+  auto it = m_expressions.find(getKey(inst));
+  if (it != m_expressions.end() && it->second == &inst)
+    m_expressions.erase(it);
 }
 
-Instruction *ManglingVisitor::visitSub(BinaryOperator &subOp) {
-  Value *lhs, *rhs;
-  if (!MATCH(&subOp, PatternMatch::m_Sub, lhs, rhs)) {
+Instruction *ExpressionCache::lookup(unsigned opcode, Value *lhs, Value *rhs,
+                                     Instruction const *insertPoint) const {
+  auto it = m_expressions.find(getKey(opcode, lhs, rhs));
+  if (it == m_expressions.end())
     return nullptr;
+
+  // Expressions are only ever shared within a block; anything created for a
+  // later operation has to be recreated rather than moved.
+  auto inst = it->second;
+  if (inst->getParent() != insertPoint->getParent() ||
+      !inst->comesBefore(insertPoint))
+    return nullptr;
+
+  return inst;
+}
+
+void ExpressionCache::insert(Instruction &inst) {
+  if (isa<BinaryOperator>(inst))
+    m_expressions[getKey(inst)] = &inst;
+}
+
+void ExpressionCache::replace(Instruction &inst, Instruction &replacement) {
+  // Every cached user of the instruction is about to change keys.
+  SmallVector<Instruction *> users;
+  for (auto user : inst.users()) {
+    auto userInst = dyn_cast<BinaryOperator>(user);
+    if (!userInst)
+      continue;
+
+    auto it = m_expressions.find(getKey(*userInst));
+    if (it != m_expressions.end() && it->second == userInst) {
+      m_expressions.erase(it);
+      users.emplace_back(userInst);
+    }
   }
 
-  return BinaryOperator::CreateAdd(
-      m_builder.CreateXor(lhs, m_builder.CreateNeg(rhs)),
-      m_builder.CreateMul(ConstantInt::get(lhs->getType(), 2),
-                          m_builder.CreateAnd(lhs, m_builder.CreateNeg(rhs))));
+  // The replacement computes the same value, so it stands in for the
+  // instruction itself too.
+  auto key = getKey(inst);
+  erase(inst);
+
+  inst.replaceAllUsesWith(&replacement);
+
+  for (auto user : users)
+    insert(*user);
+  insert(replacement);
+  m_expressions[key] = &replacement;
 }
 
-Instruction *ManglingVisitor::visitAnd(BinaryOperator &andOp) {
-  Value *lhs, *rhs;
-  if (!MATCH(&andOp, PatternMatch::m_And, lhs, rhs)) {
-    return nullptr;
+IdentitySelector::IdentitySelector(TargetTransformInfo const &tti,
+                                   unsigned strength)
+    : m_tti(tti), m_strength(strength) {}
+
+SmallVector<MBAIdentity const *> const &
+IdentitySelector::getCandidates(unsigned opcode, Type *type) {
+  auto [it, inserted] = m_candidates.try_emplace({opcode, type});
+  auto &candidates = it->second;
+  if (inserted) {
+    auto identities = getMBAIdentities(opcode);
+
+    // Settle for the largest identities if none are as strong as requested.
+    size_t minSize = 0;
+    for (auto &identity : identities)
+      minSize = std::max(minSize, identity.nodes.size());
+    minSize = std::min<size_t>(minSize, m_strength);
+
+    InstructionCost bestCost;
+    for (auto &identity : identities) {
+      if (identity.nodes.size() < minSize)
+        continue;
+
+      auto cost = getMBAIdentityCost(identity, type, m_tti);
+      if (candidates.empty() || cost < bestCost) {
+        candidates.clear();
+        bestCost = cost;
+      }
+      if (cost == bestCost)
+        candidates.emplace_back(&identity);
+    }
   }
 
-  return BinaryOperator::CreateSub(m_builder.CreateAdd(lhs, rhs),
-                                   m_builder.CreateOr(lhs, rhs));
+  return candidates;
+}
+
+bool IdentitySelector::canSelect(unsigned opcode, Type *type) {
+  return !getCandidates(opcode, type).empty();
 }
 
-Instruction *ManglingVisitor::visitOr(BinaryOperator &orOp) {
-  Value *lhs, *rhs;
-  if (!MATCH(&orOp, PatternMatch::m_Or, lhs, rhs)) {
+MBAIdentity const *IdentitySelector::select(unsigned opcode, Type *type) {
+  auto &candidates = getCandidates(opcode, type);
+  if (candidates.empty())
     return nullptr;
-  }
 
-  return BinaryOperator::CreateAdd(
-      m_builder.CreateAdd(m_builder.CreateAdd(lhs, rhs),
-                          ConstantInt::get(lhs->getType(), 1)),
-      m_builder.CreateOr(m_builder.CreateNot(lhs), m_builder.CreateNot(rhs)));
+  return candidates.size() == 1 ? candidates.front()
+                                : getRandomItem(candidates);
+}
+
+ManglingVisitor::ManglingVisitor(BasicBlock *block, IdentitySelector &selector,
+                                 ExpressionCache *cache)
+    : m_builder(IRBuilder<NoFolder>(block)), m_selector(selector),
+      m_cache(cache) {}
+
+void ManglingVisitor::setInsertPoint(Instruction *inst) {
+  m_builder.SetInsertPoint(inst);
+}
+
+Value *ManglingVisitor::createBinOp(Instruction::BinaryOps opcode, Value *lhs,
+                                    Value *rhs) {
+  if (!m_cache)
+    return m_builder.CreateBinOp(opcode, lhs, rhs);
+
+  auto insertPoint = &*m_builder.GetInsertPoint();
+  if (auto existing = m_cache->lookup(opcode, lhs, rhs, insertPoint))
+    return existing;
+
+  auto inst = cast<Instruction>(m_builder.CreateBinOp(opcode, lhs, rhs));
+  m_cache->insert(*inst);
+  return inst;
 }
 
-Instruction *ManglingVisitor::visitXor(BinaryOperator &xorOp) {
-  Value *lhs, *rhs;
-  if (!MATCH(&xorOp, PatternMatch::m_Xor, lhs, rhs)) {
+Instruction *ManglingVisitor::visitBinaryOperator(BinaryOperator &op) {
+  auto identity = m_selector.select(op.getOpcode(), op.getType());
+  if (!identity)
     return nullptr;
-  }
 
-  return BinaryOperator::CreateSub(m_builder.CreateOr(lhs, rhs),
-                                   m_builder.CreateAnd(lhs, rhs));
+  SmallVector<Value *, 8> nodes;
+  auto getOperand = [&](int operand) -> Value * {
+    if (operand >= 0)
+      return nodes[operand];
+    if (operand == MBAOperandX)
+      return op.getOperand(0);
+    if (operand == MBAOperandY)
+      return op.getOperand(1);
+
+    return getMBAConstant(operand, op.getType());
+  };
+
+  // The last node is the result, which is handed back to the caller to insert.
+  for (auto &node : identity->nodes.drop_back())
+    nodes.emplace_back(createBinOp(node.opcode, getOperand(node.lhs),
+                                   getOperand(node.rhs)));
+
+  auto &result = identity->nodes.back();
+  return BinaryOperator::Create(result.opcode, getOperand(result.lhs),
+                                getOperand(result.rhs));
 }
 
 bool ArithmeticManglerPass::canMangleOperation(BinaryOperator const *op) {
@@ -112,12 +236,19 @@ Function *ArithmeticManglerPass::createBinaryOpStub(Module *module,
 }
 
 void ArithmeticManglerPass::insertStubs(Function &func,
-                                        std::vector<Function *> &stubs) {
+                                        std::vector<Function *> &stubs,
+                                        FunctionCostModel &costModel,
+                                        int rounds) {
+  auto &config = Config::get()->arithmeticMangler;
+  auto cost = getManglingCost(rounds, config.budget);
+
   SmallVector<Instruction *> replacedInstructions;
   for (auto &inst : instructions(func)) {
     auto binaryOp = dyn_cast<BinaryOperator>(&inst);
     if (!binaryOp || !canMangleOperation(binaryOp))
       continue;
+    if (!costModel.trySpend(*inst.getParent(), cost))
+      continue;
 
     auto lhs = binaryOp->getOperand(0);
     auto rhs = binaryOp->getOperand(1);
@@ -135,9 +266,174 @@ void ArithmeticManglerPass::insertStubs(Function &func,
     inst->eraseFromParent();
 }
 
+unsigned ArithmeticManglerPass::mangleOperations(
+    ArrayRef<Instruction *> operations, TargetTransformInfo const &tti,
+    int rounds, unsigned budget, function_ref<bool(Instruction &)> tryCharge) {
+  // Largest number of instructions added by rewriting a single operation once
+  // (i.e. the size of the largest identity, minus the operation it replaces).
+  auto maxRewriteGrowth = getMaxMBAIdentitySize() - 1;
+
+  // Each worklist entry is an operation to mangle, along with the index of
+  // the original operation it is part of the expansion of.
+  SmallVector<std::pair<Instruction *, unsigned>> worklist;
+  for (unsigned i = 0; i < operations.size(); ++i)
+    worklist.emplace_back(operations[i], i);
+
+  // Number of instructions each original operation has been expanded into.
+  SmallVector<unsigned> sizes(operations.size(), 1);
+
+  IdentitySelector selector(tti, Config::get()->arithmeticMangler.strength);
+  ExpressionCache cache;
+  auto sharedCache = budget ? &cache : nullptr;
+
+  unsigned numRewritten = 0;
+
+  // Each round mirrors one round over a stub function's body, where every
+  // operation produced by the previous round is mangled once more. Rather than
+  // rescanning the function, the operations created by each rewrite are
+  // collected as they are inserted and form the worklist for the next round.
+  //
+  // Without a budget, this grows every operation exponentially with the
+  // number of rounds; with one, operations stop being rewritten once their
+  // expansion would outgrow it, and the growth per round shrinks as more of
+  // each new expression is shared with the previous ones.
+  for (int i = 0; i < rounds && !worklist.empty(); ++i) {
+    SmallVector<std::pair<Instruction *, unsigned>> nextWorklist;
+    for (auto [inst, origin] : worklist) {
+      if (budget && sizes[origin] + maxRewriteGrowth > budget)
+        continue;
+
+      // Operations created by earlier rounds have been paid for along with
+      // the original operation they are part of; only charge for the original
+      // operations, once it is certain that they will be rewritten.
+      if (i == 0 &&
+          (!selector.canSelect(inst->getOpcode(), inst->getType()) ||
+           (tryCharge && !tryCharge(*inst))))
+        continue;
+
+      auto block = inst->getParent();
+      auto previous = inst->getPrevNode();
+
+      ManglingVisitor visitor(block, selector, sharedCache);
+      visitor.setInsertPoint(inst);
+      auto replacement = visitor.visit(*inst);
+      if (!replacement || replacement == inst)
+        continue;
+
+      replacement->takeName(inst);
+      replacement->insertInto(block, inst->getIterator());
+      if (sharedCache)
+        sharedCache->replace(*inst, *replacement);
+      else
+        inst->replaceAllUsesWith(replacement);
+
+      // Everything between the previous instruction and the original one was
+      // just created by the visitor (the replacement included); subexpressions
+      // which were shared are elsewhere, and have been counted already.
+      auto it = previous ? std::next(previous->getIterator()) : block->begin();
+      for (; &*it != inst; ++it) {
+        ++sizes[origin];
+
+        auto binaryOp = dyn_cast<BinaryOperator>(&*it);
+        if (binaryOp && canMangleOperation(binaryOp))
+          nextWorklist.emplace_back(binaryOp, origin);
+      }
+
+      --sizes[origin];
+      inst->eraseFromParent();
+      if (i == 0)
+        ++numRewritten;
+    }
+
+    worklist = std::move(nextWorklist);
+  }
+
+  return numRewritten;
+}
+
+unsigned ArithmeticManglerPass::mangleInPlace(Function &func,
+                                              TargetTransformInfo const &tti,
+                                              FunctionCostModel &costModel,
+                                              int rounds) {
+  auto &config = Config::get()->arithmeticMangler;
+  auto cost = getManglingCost(rounds, config.budget);
+
+  SmallVector<Instruction *> operations;
+  for (auto &inst : instructions(func)) {
+    auto binaryOp = dyn_cast<BinaryOperator>(&inst);
+    if (binaryOp && canMangleOperation(binaryOp))
+      operations.emplace_back(binaryOp);
+  }
+
+  RandomStreamScope randomScope("arithmetic-mangler", func.getName());
+  return mangleOperations(
+      operations, tti, rounds, config.budget, [&](Instruction &inst) {
+        return costModel.trySpend(*inst.getParent(), cost);
+      });
+}
+
 PreservedAnalyses ArithmeticManglerPass::run(Module &module,
-                                             ModuleAnalysisManager &) {
+                                             ModuleAnalysisManager &mam) {
   auto config = Config::get();
+  auto &selection = mam.getResult<FunctionSelectionAnalysis>(module);
+  auto &cost = mam.getResult<ObfuscationCostAnalysis>(module);
+  auto &fam =
+      mam.getResult<FunctionAnalysisManagerModuleProxy>(module).getManager();
+
+  // Get the cost model to mangle \p function under, or report why it isn't
+  // mangled at all.
+  auto getCostModel = [&](Function &function, OptimizationRemarkEmitter &ore)
+      -> std::optional<FunctionCostModel> {
+    StringRef reason = "not selected";
+    if (selection.shouldRunOnFunction(config->arithmeticMangler, function)) {
+      auto costModel = cost.getModel(function, mam);
+      if (!costModel.isFunctionHot())
+        return costModel;
+
+      reason = "hot";
+    }
+
+    reportSkippedFunction(ore, DEBUG_TYPE, function, reason);
+    ++NumFunctionsSkipped;
+    return std::nullopt;
+  };
+
+  // Get the number of rounds to mangle \p function over.
+  auto getRounds = [&](Function const &function) {
+    auto rounds = config->arithmeticMangler.rounds;
+    if (auto functionOverride = selection.getOverride(function))
+      rounds = functionOverride->arithmeticManglerRounds.value_or(rounds);
+    return rounds;
+  };
+
+  if (config->arithmeticMangler.useInPlaceRewriting) {
+    bool changed = false;
+    for (auto &function : module) {
+      if (function.isDeclaration())
+        continue;
+
+      auto &ore = fam.getResult<OptimizationRemarkEmitterAnalysis>(function);
+      auto costModel = getCostModel(function, ore);
+      if (!costModel)
+        continue;
+
+      auto instructionsBefore = function.getInstructionCount();
+      auto numMangled =
+          mangleInPlace(function, fam.getResult<TargetIRAnalysis>(function),
+                        *costModel, getRounds(function));
+      changed |= numMangled != 0;
+
+      auto instructionsAfter = function.getInstructionCount();
+      reportObfuscatedFunction(ore, DEBUG_TYPE, function, instructionsBefore,
+                               instructionsAfter,
+                               {{"operations", numMangled}});
+      ++NumFunctionsMangled;
+      NumOperationsMangled += numMangled;
+      NumInstructionsAdded += instructionsAfter - instructionsBefore;
+    }
+
+    return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+  }
 
   // Since the MBA stub functions are created on-demand (and parented to the
   // current module) the module's function list cannot be used directly as the
@@ -152,15 +448,41 @@ PreservedAnalyses ArithmeticManglerPass::run(Module &module,
       module.getFunctionList().begin(), module.getFunctionList().end(),
       std::back_inserter(originalFunctions), [](Function &f) { return &f; });
 
+  // Functions which had stubs inserted, along with their size beforehand, the
+  // rounds to mangle their stubs over, the range of `stubFunctions` holding
+  // their stubs, and the number of operations mangled across those stubs; they
+  // are only reported on once their stubs have been mangled, as that is where
+  // they grow.
+  struct MangledFunction {
+    Function *function;
+    OptimizationRemarkEmitter *ore;
+    unsigned instructionsBefore;
+    int rounds;
+    size_t firstStub;
+    size_t lastStub;
+    unsigned numMangled = 0;
+  };
+  SmallVector<MangledFunction> mangledFunctions;
+
   // Iterate through all of the module's functions (that match the filtering
   // criteria for the pass), replacing obfuscatable arithmetic expressions with
   // calls to MBA stub functions.
   std::vector<Function *> stubFunctions;
   for (auto function : originalFunctions) {
-    if (!config->arithmeticMangler.shouldRunOnFunction(*function))
+    if (function->isDeclaration())
+      continue;
+
+    auto &ore = fam.getResult<OptimizationRemarkEmitterAnalysis>(*function);
+    auto costModel = getCostModel(*function, ore);
+    if (!costModel)
       continue;
 
-    insertStubs(*function, stubFunctions);
+    auto instructionsBefore = function->getInstructionCount();
+    auto rounds = getRounds(*function);
+    auto firstStub = stubFunctions.size();
+    insertStubs(*function, stubFunctions, *costModel, rounds);
+    mangledFunctions.push_back({function, &ore, instructionsBefore, rounds,
+                                firstStub, stubFunctions.size()});
   }
 
   // The stub functions created simply extracted the original arithmetic
@@ -168,31 +490,43 @@ PreservedAnalyses ArithmeticManglerPass::run(Module &module,
   // yet.
   //
   // Each stub function needs to be processed and have MBA equivalents of its
-  // operations inserted where appropriate.
-  for (auto stub : stubFunctions) {
-    for (int i = 0; i < config->arithmeticMangler.rounds; ++i) {
-      for (auto &block : *stub) {
-        ManglingVisitor visitor(&block);
-
-        SmallVector<Instruction *> replacedInstructions;
-        for (auto &inst : block) {
-          visitor.setInsertPoint(&inst);
-          auto replacement = visitor.visit(inst);
-          if (!replacement || replacement == &inst)
-            continue;
-
-          replacement->takeName(&inst);
-          replacement->insertInto(&block, inst.getIterator());
-          inst.replaceAllUsesWith(replacement);
-          replacedInstructions.push_back(&inst);
-        }
-
-        for (auto inst : replacedInstructions)
-          inst->eraseFromParent();
+  // operations inserted where appropriate, over as many rounds as the function
+  // it was extracted from asks for.
+  for (auto &mangled : mangledFunctions) {
+    for (auto i = mangled.firstStub; i < mangled.lastStub; ++i) {
+      auto stub = stubFunctions[i];
+      SmallVector<Instruction *> operations;
+      for (auto &inst : instructions(*stub)) {
+        auto binaryOp = dyn_cast<BinaryOperator>(&inst);
+        if (binaryOp && canMangleOperation(binaryOp))
+          operations.emplace_back(binaryOp);
       }
+
+      RandomStreamScope randomScope("arithmetic-mangler", stub->getName());
+      mangled.numMangled += mangleOperations(
+          operations, fam.getResult<TargetIRAnalysis>(*stub), mangled.rounds,
+          config->arithmeticMangler.budget);
     }
   }
 
+  // Stubs are always inlined back into their callers, so their instructions
+  // count towards the function they were extracted from.
+  for (auto const &mangled : mangledFunctions) {
+    uint64_t instructionsAfter = mangled.function->getInstructionCount();
+    for (auto i = mangled.firstStub; i < mangled.lastStub; ++i)
+      instructionsAfter += stubFunctions[i]->getInstructionCount();
+
+    auto numStubs = mangled.lastStub - mangled.firstStub;
+    reportObfuscatedFunction(*mangled.ore, DEBUG_TYPE, *mangled.function,
+                             mangled.instructionsBefore, instructionsAfter,
+                             {{"operations", mangled.numMangled},
+                              {"stubs", numStubs}});
+    ++NumFunctionsMangled;
+    NumOperationsMangled += mangled.numMangled;
+    NumStubsCreated += numStubs;
+    NumInstructionsAdded += instructionsAfter - mangled.instructionsBefore;
+  }
+
   return stubFunctions.empty() ? PreservedAnalyses::none()
                                : PreservedAnalyses::all();
 }
@@ -9,22 +9,42 @@
 
 #include "Limoncello/Pass/Bloater.h"
 
+#include "Limoncello/Analysis/FunctionSelection.h"
+#include "Limoncello/Analysis/ObfuscationCost.h"
 #include "Limoncello/Config/Config.h"
+#include "Limoncello/Support/DispatchProfile.h"
 #include "Limoncello/Support/Function.h"
 #include "Limoncello/Support/Module.h"
+#include "Limoncello/Support/OpaquePredicate.h"
 #include "Limoncello/Support/Random.h"
+#include "Limoncello/Support/Report.h"
 
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/OptimizationRemarkEmitter.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Transforms/Utils/ValueMapper.h>
 
+#define DEBUG_TYPE "bloater"
+
+STATISTIC(NumFunctionsBloated, "Number of functions bloated");
+STATISTIC(NumFunctionsSkipped, "Number of functions not bloated");
+STATISTIC(NumGarbageBlocks, "Number of garbage blocks created");
+STATISTIC(NumInstructionsAdded, "Number of instructions added");
+STATISTIC(NumValuesDemoted, "Number of values demoted to the stack");
+
 using namespace llvm;
 
 /// Magic value returned from the "opaque true" function.
 static constexpr uint64_t BloaterMagic = 0x3636365f4f434d4c;
 static constexpr uint64_t BloaterMagicSafeMask = 0xfffffffffffff;
 
+/// Weight of the real edge out of a dispatch block, relative to a weight of
+/// one for the edge to the garbage block (which is never taken).
+static constexpr uint32_t GarbageBranchTrueWeight = 1 << 20;
+
 /// Set of predicates that will always result in a truthy value when used to
 /// compare a random 32-bit number to the magic value using a comparison in the
 /// form of `magic <Predicate> random`.
@@ -83,8 +103,34 @@ Function *BloaterPass::getOpaqueTrueFunction(Module &module) {
   return func;
 }
 
-void BloaterPass::bloatFunction(llvm::Function &func) {
+Value *BloaterPass::getPredicateOperand(IRBuilder<> &builder,
+                                        BasicBlock *block) {
+  // Values computed in the block are live at its end anyway, and make for a
+  // predicate that depends on the surrounding code; they are frozen, as
+  // branching on a predicate over poison would be undefined behavior.
+  SmallVector<Instruction *> candidates;
+  for (auto &inst : *block) {
+    auto type = dyn_cast<IntegerType>(inst.getType());
+    if (type && type->getBitWidth() <= 64)
+      candidates.emplace_back(&inst);
+  }
+
+  if (candidates.empty()) {
+    auto module = block->getModule();
+    return builder.CreateLoad(builder.getInt64Ty(), getOpaqueGlobal(*module));
+  }
+
+  auto value = builder.CreateFreeze(getRandomItem(candidates));
+  return builder.CreateZExtOrTrunc(value, builder.getInt64Ty());
+}
+
+unsigned BloaterPass::bloatFunction(llvm::Function &func,
+                                    FunctionCostModel &costModel,
+                                    int probability,
+                                    BranchIndexMap const &branchIndices,
+                                    unsigned firstPointIndex) {
   auto config = Config::get();
+  auto profile = DispatchProfile::get();
   auto &module = *func.getParent();
   auto opaqueGlobal = getOpaqueGlobal(module);
 
@@ -99,6 +145,7 @@ void BloaterPass::bloatFunction(llvm::Function &func) {
     bloatingSet.emplace_back(&block);
   }
 
+  unsigned numBloated = 0;
   for (auto block : bloatingSet) {
     auto term = block->getTerminator();
     if (!term)
@@ -107,12 +154,38 @@ void BloaterPass::bloatFunction(llvm::Function &func) {
     if (!branch || branch->isConditional())
       continue;
 
+    // Blocks created by earlier rounds depend on which branches the random
+    // rolls (and the profile) picked, so they are left alone; this keeps the
+    // numbering of dispatch points the same between builds.
+    auto branchIndex = branchIndices.find(block);
+    if (branchIndex == branchIndices.end())
+      continue;
+
+    auto pointIndex = firstPointIndex + branchIndex->second;
+
     // Bloating every branch matching the conditions above might be a bit too
     // aggressive; roll a die and randomly decide if this branch should be
     // bloated with respect to the configured probability.
     //
     // This comparison looks backwards at first but it makes sense, I promise.
-    if (getRandomInt32() % 100 > config->bloater.probability)
+    if (getRandomInt32() % 100 > probability)
+      continue;
+
+    if (profile && profile->isHotPoint(DispatchPointKind::BloaterDispatch,
+                                       func, pointIndex))
+      continue;
+
+    // Only roll for a predicate if there's more than one to choose from, so
+    // that the default configuration keeps producing the same output.
+    auto const &predicates = config->bloater.predicates;
+    auto predicateKind = OpaquePredicateKind::Call;
+    if (predicates.size() == 1)
+      predicateKind = predicates.front();
+    else if (predicates.size() > 1)
+      predicateKind = predicates[getRandomInt64() % predicates.size()];
+
+    // The dispatch block is made up of the predicate and a branch on it.
+    if (!costModel.trySpend(*block, getOpaquePredicateCost(predicateKind) + 1))
       continue;
 
     // Find where this block is supposed to branch to, then erase the branch.
@@ -122,9 +195,13 @@ void BloaterPass::bloatFunction(llvm::Function &func) {
     // Clone the intended destination block in order to create the starting
     // basis for our "garbage block", insert it into the function, then erase
     // the branch to the following block.
+    //
+    // Garbage blocks are never executed, so they're kept out of the way of
+    // real code at the end of the function; this matters most without
+    // optimizations, where blocks are laid out in IR order.
     ValueToValueMapTy map;
     auto garbageBlock = CloneBasicBlock(nextBlock, map);
-    garbageBlock->insertInto(&func, nextBlock);
+    garbageBlock->insertInto(&func);
     if (garbageBlock->getTerminator())
       garbageBlock->getTerminator()->eraseFromParent();
 
@@ -134,16 +211,37 @@ void BloaterPass::bloatFunction(llvm::Function &func) {
     auto dispatchBlock = BasicBlock::Create(func.getContext(), "dispatch");
     dispatchBlock->insertInto(&func, nextBlock);
 
-    // Populate the dispatch block with some garbage code followed by a call
-    // to the opaque "always true" function, then use the result to branch to
+    // Populate the dispatch block with an opaque predicate (by default, a call
+    // to the opaque "always true" function), then use the result to branch to
     // the real block (but retain the garbage block as a possible destination,
     // as far as LLVM is concerned).
     IRBuilder<> dispatchBuilder(dispatchBlock);
-    auto opaqueTrue = dispatchBuilder.CreateCmp(
-        getRandomItem(truePredicates),
-        dispatchBuilder.CreateCall(getOpaqueTrueFunction(module)),
-        dispatchBuilder.getInt64(getRandomInt32()));
-    dispatchBuilder.CreateCondBr(opaqueTrue, nextBlock, garbageBlock);
+    if (config->dispatchProfile.instrument)
+      insertDispatchCounter(dispatchBuilder,
+                            DispatchPointKind::BloaterDispatch, pointIndex);
+
+    Value *opaqueTrue = nullptr;
+    if (predicateKind == OpaquePredicateKind::Call) {
+      opaqueTrue = dispatchBuilder.CreateCmp(
+          getRandomItem(truePredicates),
+          dispatchBuilder.CreateCall(getOpaqueTrueFunction(module)),
+          dispatchBuilder.getInt64(getRandomInt32()));
+    } else {
+      // The operand is computed at the end of the original block, where all of
+      // its values are still available.
+      IRBuilder<> operandBuilder(block);
+      opaqueTrue = createOpaquePredicate(
+          dispatchBuilder, predicateKind,
+          getPredicateOperand(operandBuilder, block));
+    }
+    // The weights let block placement move garbage blocks out of the hot path
+    // and, with profile data, machine function splitting move them out to a
+    // cold section entirely.
+    dispatchBuilder.CreateCondBr(
+        opaqueTrue, nextBlock, garbageBlock,
+        MDBuilder(func.getContext())
+            .createBranchWeights(/*TrueWeight=*/GarbageBranchTrueWeight,
+                                 /*FalseWeight=*/1));
 
     // Add a meaningless store to the opaque global value at the start of the
     // copied block and a meaningless load of the same value at the end.
@@ -171,22 +269,76 @@ void BloaterPass::bloatFunction(llvm::Function &func) {
     // Create an unconditional branch to the dispatch block created above.
     IRBuilder<> opaqueBuilder(block);
     opaqueBuilder.CreateBr(dispatchBlock);
+    ++numBloated;
   }
+
+  return numBloated;
 }
 
-PreservedAnalyses BloaterPass::run(Module &module, ModuleAnalysisManager &) {
+PreservedAnalyses BloaterPass::run(Module &module,
+                                   ModuleAnalysisManager &mam) {
   auto config = Config::get();
+  auto &selection = mam.getResult<FunctionSelectionAnalysis>(module);
+  auto &cost = mam.getResult<ObfuscationCostAnalysis>(module);
+  auto &fam =
+      mam.getResult<FunctionAnalysisManagerModuleProxy>(module).getManager();
 
   bool changed = false;
   for (auto &func : module.getFunctionList()) {
-    if (!config->bloater.shouldRunOnFunction(func))
+    if (func.isDeclaration())
       continue;
 
-    for (int i = 0; i < config->bloater.rounds; ++i)
-      bloatFunction(func);
+    auto &ore = fam.getResult<OptimizationRemarkEmitterAnalysis>(func);
+    if (!selection.shouldRunOnFunction(config->bloater, func)) {
+      reportSkippedFunction(ore, DEBUG_TYPE, func, "not selected");
+      ++NumFunctionsSkipped;
+      continue;
+    }
 
-    repairSSA(func);
+    auto costModel = cost.getModel(func, mam);
+    if (costModel.isFunctionHot()) {
+      reportSkippedFunction(ore, DEBUG_TYPE, func, "hot");
+      ++NumFunctionsSkipped;
+      continue;
+    }
+
+    auto instructionsBefore = func.getInstructionCount();
+    RandomStreamScope randomScope("bloater", func.getName());
+    unsigned numBloated = 0;
+    auto rounds = config->bloater.rounds;
+    auto probability = config->bloater.probability;
+    if (auto functionOverride = selection.getOverride(func)) {
+      rounds = functionOverride->bloaterRounds.value_or(rounds);
+      probability = functionOverride->bloaterProbability.value_or(probability);
+    }
+
+    // Every round puts a new dispatch block in front of the same branches, so
+    // each round gets a range of dispatch points of its own.
+    BranchIndexMap branchIndices;
+    for (auto &block : func) {
+      auto branch = dyn_cast_or_null<BranchInst>(block.getTerminator());
+      if (&block != &func.getEntryBlock() && branch &&
+          branch->isUnconditional())
+        branchIndices.try_emplace(&block, branchIndices.size());
+    }
+
+    for (int i = 0; i < rounds; ++i)
+      numBloated += bloatFunction(func, costModel, probability, branchIndices,
+                                  i * branchIndices.size());
+
+    auto numDemoted = repairSSA(func);
     changed |= true;
+
+    // Each bloated branch adds a garbage block (and a dispatch block).
+    auto instructionsAfter = func.getInstructionCount();
+    reportObfuscatedFunction(ore, DEBUG_TYPE, func, instructionsBefore,
+                             instructionsAfter,
+                             {{"garbage-blocks", numBloated},
+                              {"values-demoted", numDemoted}});
+    ++NumFunctionsBloated;
+    NumGarbageBlocks += numBloated;
+    NumValuesDemoted += numDemoted;
+    NumInstructionsAdded += instructionsAfter - instructionsBefore;
   }
 
   return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
@@ -9,18 +9,39 @@
 
 #include "Limoncello/Pass/ConstantMangler.h"
 
+#include "Limoncello/Analysis/FunctionSelection.h"
+#include "Limoncello/Analysis/ObfuscationCost.h"
 #include "Limoncello/Config/Config.h"
 #include "Limoncello/Support/Module.h"
 #include "Limoncello/Support/Random.h"
+#include "Limoncello/Support/Report.h"
 
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/OptimizationRemarkEmitter.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/NoFolder.h>
 
+#define DEBUG_TYPE "constant-mangler"
+
+STATISTIC(NumFunctionsMangled, "Number of functions with constants mangled");
+STATISTIC(NumFunctionsSkipped, "Number of functions not mangled");
+STATISTIC(NumConstantsMangled, "Number of constants mangled");
+STATISTIC(NumInstructionsAdded, "Number of instructions added");
+
 using namespace llvm;
 
+/// Estimated number of instructions added per mangled constant, when the
+/// opaque value is loaded right before it.
+static constexpr double MangledConstantCost = 4;
+
+/// Estimated number of instructions added per mangled constant, when the
+/// opaque value is shared with other constants.
+static constexpr double SharedMangledConstantCost = 2;
+
 bool ConstantManglerPass::canMangleInstruction(Instruction const &insn) {
   if (isa<CallInst>(insn) || isa<SwitchInst>(insn) ||
       isa<GetElementPtrInst>(insn) || isa<PHINode>(insn) || insn.isAtomic())
@@ -29,25 +50,81 @@ bool ConstantManglerPass::canMangleInstruction(Instruction const &insn) {
   return true;
 }
 
-bool ConstantManglerPass::mangleFunctionConstants(Function &func) {
+Instruction *ConstantManglerPass::getOpaqueLoadPoint(Instruction &inst,
+                                                     LoopInfo const *loops) {
+  auto &config = Config::get()->constantMangler;
+  switch (config.opaqueLoadScope) {
+  case OpaqueLoadScope::Use:
+    break;
+  case OpaqueLoadScope::Function:
+    return &*inst.getFunction()->getEntryBlock().getFirstInsertionPt();
+  case OpaqueLoadScope::Loop: {
+    auto loop = loops->getLoopFor(inst.getParent());
+    if (!loop)
+      break;
+
+    // Hoist all the way out of nested loops; without a preheader to put the
+    // load in (which is rare for front end output), fall back to loading it
+    // before every use.
+    loop = loop->getOutermostLoop();
+    if (auto preheader = loop->getLoopPreheader())
+      return preheader->getTerminator();
+    break;
+  }
+  }
+
+  return &inst;
+}
+
+Value *ConstantManglerPass::getOpaqueValue(Constant *opaqueGlobal,
+                                           Instruction *loadPoint, Type *type,
+                                           OpaqueValueMap &values) {
+  auto cached = values.find({loadPoint, type});
+  if (cached != values.end())
+    return cached->second;
+
+  // Truncations are inserted after the load itself, but still before the load
+  // point, so they dominate everything the load does.
+  IRBuilder<NoFolder> irb(loadPoint);
+  auto int64Ty = Type::getInt64Ty(loadPoint->getContext());
+  Value *value;
+  if (type == int64Ty)
+    value = irb.CreateLoad(int64Ty, opaqueGlobal);
+  else
+    value = irb.CreateZExtOrTrunc(
+        getOpaqueValue(opaqueGlobal, loadPoint, int64Ty, values), type);
+
+  values[{loadPoint, type}] = value;
+  return value;
+}
+
+unsigned ConstantManglerPass::mangleFunctionConstants(
+    Function &func, FunctionCostModel &costModel, LoopInfo const *loops) {
   auto module = func.getParent();
   auto int64Ty = Type::getInt64Ty(module->getContext());
   auto opaqueGlobal = getOrInsertGlobal(*module, "__lmcoOpaqueGlobal",
                                         ConstantInt::get(int64Ty, 0));
 
-  bool changed = false;
+  OpaqueValueMap opaqueValues;
+  unsigned numMangled = 0;
   for (auto &inst : instructions(func)) {
     if (!canMangleInstruction(inst))
       continue;
 
     for (auto &op : inst.operands()) {
       if (auto *intOp = dyn_cast<ConstantInt>(op)) {
+        auto loadPoint = getOpaqueLoadPoint(inst, loops);
+        auto cost = loadPoint == &inst ? MangledConstantCost
+                                       : SharedMangledConstantCost;
+        if (!costModel.trySpend(*inst.getParent(), cost))
+          continue;
+
         auto intType = intOp->getType();
         auto xorKey = getRandomInt64();
 
         IRBuilder<NoFolder> irb(&inst);
-        auto rawOpaqueValue = irb.CreateLoad(int64Ty, opaqueGlobal);
-        auto opaqueValue = irb.CreateTrunc(rawOpaqueValue, intType);
+        auto opaqueValue =
+            getOpaqueValue(opaqueGlobal, loadPoint, intType, opaqueValues);
         auto mangledConstant =
             ConstantInt::get(intType, intOp->getValue() ^ xorKey);
         auto opacifiedKey =
@@ -55,23 +132,56 @@ bool ConstantManglerPass::mangleFunctionConstants(Function &func) {
         auto xorExpr = irb.CreateXor(mangledConstant, opacifiedKey);
 
         op.set(xorExpr);
-        changed |= true;
+        ++numMangled;
       }
     }
   }
 
-  return changed;
+  return numMangled;
 }
 
 PreservedAnalyses ConstantManglerPass::run(Module &module,
-                                           ModuleAnalysisManager &) {
+                                           ModuleAnalysisManager &mam) {
+  auto &selection = mam.getResult<FunctionSelectionAnalysis>(module);
+  auto &cost = mam.getResult<ObfuscationCostAnalysis>(module);
+  auto &fam =
+      mam.getResult<FunctionAnalysisManagerModuleProxy>(module).getManager();
+  auto &config = Config::get()->constantMangler;
+
   bool changed = false;
   for (auto &func : module.getFunctionList()) {
-    if (!Config::get()->constantMangler.shouldRunOnFunction(func))
+    if (func.isDeclaration())
+      continue;
+
+    auto &ore = fam.getResult<OptimizationRemarkEmitterAnalysis>(func);
+    if (!selection.shouldRunOnFunction(config, func)) {
+      reportSkippedFunction(ore, DEBUG_TYPE, func, "not selected");
+      ++NumFunctionsSkipped;
       continue;
+    }
+
+    auto costModel = cost.getModel(func, mam);
+    if (costModel.isFunctionHot()) {
+      reportSkippedFunction(ore, DEBUG_TYPE, func, "hot");
+      ++NumFunctionsSkipped;
+      continue;
+    }
+
+    LoopInfo *loops = nullptr;
+    if (config.opaqueLoadScope == OpaqueLoadScope::Loop)
+      loops = &fam.getResult<LoopAnalysis>(func);
 
-    mangleFunctionConstants(func);
+    auto instructionsBefore = func.getInstructionCount();
+    RandomStreamScope randomScope("constant-mangler", func.getName());
+    auto numMangled = mangleFunctionConstants(func, costModel, loops);
     changed |= true;
+
+    auto instructionsAfter = func.getInstructionCount();
+    reportObfuscatedFunction(ore, DEBUG_TYPE, func, instructionsBefore,
+                             instructionsAfter, {{"constants", numMangled}});
+    ++NumFunctionsMangled;
+    NumConstantsMangled += numMangled;
+    NumInstructionsAdded += instructionsAfter - instructionsBefore;
   }
 
   return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
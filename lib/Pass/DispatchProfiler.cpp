@@ -0,0 +1,156 @@
+//===-- Pass/DispatchProfiler.cpp - Dispatch profile runtime --------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Pass/DispatchProfiler.h"
+
+#include "Limoncello/Config/Config.h"
+#include "Limoncello/Support/DispatchProfile.h"
+#include "Limoncello/Support/Module.h"
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+constexpr auto FunctionNameDump = "__lmcoDispatchProfileDump";
+constexpr auto GlobalNameCounters = "__lmcoDispatchCounters";
+constexpr auto GlobalNameHeader = "__lmcoDispatchHeader";
+constexpr auto GlobalNamePoints = "__lmcoDispatchPoints";
+
+using namespace llvm;
+
+Function *DispatchProfilerPass::createDumpFunction(Module &module,
+                                                   GlobalVariable *header,
+                                                   GlobalVariable *points,
+                                                   GlobalVariable *counters,
+                                                   uint64_t numPoints) {
+  auto &context = module.getContext();
+  auto voidTy = Type::getVoidTy(context);
+  auto int32Ty = Type::getInt32Ty(context);
+  auto ptrTy = PointerType::getUnqual(context);
+  auto sizeTy = module.getDataLayout().getIntPtrType(context);
+
+  // Profiles are only written by instrumented builds, which are run in a
+  // hosted environment; stdio is the most portable way to append to a file.
+  auto fopenFn = module.getOrInsertFunction("fopen", ptrTy, ptrTy, ptrTy);
+  auto fwriteFn = module.getOrInsertFunction("fwrite", sizeTy, ptrTy, sizeTy,
+                                             sizeTy, ptrTy);
+  auto fcloseFn = module.getOrInsertFunction("fclose", int32Ty, ptrTy);
+
+  auto dumpFn =
+      Function::Create(FunctionType::get(voidTy, false),
+                       Config::get()->getDefaultLinkage(),
+                       getModuleSpecificName(module, FunctionNameDump), module);
+  dumpFn->addFnAttr(Attribute::NoInline);
+  dumpFn->addFnAttr(Attribute::Cold);
+
+  auto entryBlock = BasicBlock::Create(context, "entry", dumpFn);
+  auto writeBlock = BasicBlock::Create(context, "write", dumpFn);
+  auto doneBlock = BasicBlock::Create(context, "done", dumpFn);
+
+  IRBuilder<> builder(entryBlock);
+  auto path = builder.CreateGlobalStringPtr(
+      Config::get()->dispatchProfile.output, "", 0, &module);
+  auto mode = builder.CreateGlobalStringPtr("ab", "", 0, &module);
+  auto file = builder.CreateCall(fopenFn, {path, mode});
+  builder.CreateCondBr(builder.CreateIsNull(file), doneBlock, writeBlock);
+
+  // Other threads may still be counting while the counters are written out;
+  // a few counts going missing doesn't matter for a profile.
+  builder.SetInsertPoint(writeBlock);
+  auto writeArray = [&](GlobalVariable *array, uint64_t count) {
+    auto elementTy = cast<ArrayType>(array->getValueType())->getElementType();
+    auto elementSize = module.getDataLayout().getTypeAllocSize(elementTy);
+    builder.CreateCall(fwriteFn, {array, ConstantInt::get(sizeTy, elementSize),
+                                  ConstantInt::get(sizeTy, count), file});
+  };
+  writeArray(header, 2);
+  writeArray(points, numPoints);
+  writeArray(counters, numPoints);
+  builder.CreateCall(fcloseFn, {file});
+  builder.CreateBr(doneBlock);
+
+  builder.SetInsertPoint(doneBlock);
+  builder.CreateRetVoid();
+
+  return dumpFn;
+}
+
+PreservedAnalyses DispatchProfilerPass::run(Module &module,
+                                            ModuleAnalysisManager &) {
+  auto pointsMetadata = module.getNamedMetadata(DispatchPointsMetadataName);
+  if (!pointsMetadata)
+    return PreservedAnalyses::all();
+
+  auto &context = module.getContext();
+  auto int32Ty = Type::getInt32Ty(context);
+  auto int64Ty = Type::getInt64Ty(context);
+  auto entryTy = StructType::get(int64Ty, int32Ty, int32Ty);
+  auto linkage = Config::get()->getDefaultLinkage();
+
+  // Counters of code which has been deleted in the meantime are gone as well,
+  // and so are their points.
+  SmallVector<GlobalVariable *> pointCounters;
+  SmallVector<Constant *> entries;
+  for (auto node : pointsMetadata->operands()) {
+    auto counter =
+        mdconst::dyn_extract_or_null<GlobalVariable>(node->getOperand(0));
+    if (!counter)
+      continue;
+
+    pointCounters.emplace_back(counter);
+    entries.emplace_back(ConstantStruct::get(
+        entryTy, {mdconst::extract<ConstantInt>(node->getOperand(2)),
+                  mdconst::extract<ConstantInt>(node->getOperand(1)),
+                  mdconst::extract<ConstantInt>(node->getOperand(3))}));
+  }
+
+  module.eraseNamedMetadata(pointsMetadata);
+  if (pointCounters.empty())
+    return PreservedAnalyses::none();
+
+  auto numPoints = pointCounters.size();
+  auto countersTy = ArrayType::get(int64Ty, numPoints);
+  auto counters = new GlobalVariable(
+      module, countersTy, /*isConstant=*/false, linkage,
+      ConstantAggregateZero::get(countersTy),
+      getModuleSpecificName(module, GlobalNameCounters));
+  counters->setAlignment(Align(8));
+
+  for (size_t i = 0; i < numPoints; ++i) {
+    auto counter = ConstantExpr::getInBoundsGetElementPtr(
+        countersTy, counters,
+        ArrayRef<Constant *>{ConstantInt::get(int32Ty, 0),
+                             ConstantInt::get(int32Ty, i)});
+    pointCounters[i]->replaceAllUsesWith(counter);
+    pointCounters[i]->eraseFromParent();
+  }
+
+  auto pointsTy = ArrayType::get(entryTy, numPoints);
+  auto points = new GlobalVariable(
+      module, pointsTy, /*isConstant=*/true, linkage,
+      ConstantArray::get(pointsTy, entries),
+      getModuleSpecificName(module, GlobalNamePoints));
+
+  auto headerTy = ArrayType::get(int64Ty, 2);
+  auto header = new GlobalVariable(
+      module, headerTy, /*isConstant=*/true, linkage,
+      ConstantArray::get(headerTy, {ConstantInt::get(int64Ty,
+                                                      DispatchProfileMagic),
+                                    ConstantInt::get(int64Ty, numPoints)}),
+      getModuleSpecificName(module, GlobalNameHeader));
+
+  // Destructors with lower priorities run later; this one should come after
+  // any others, which may still go through dispatch points.
+  auto dumpFn = createDumpFunction(module, header, points, counters, numPoints);
+  appendToGlobalDtors(module, dumpFn, /*Priority=*/0);
+
+  return PreservedAnalyses::none();
+}
@@ -9,19 +9,42 @@
 
 #include "Limoncello/Pass/Flattener.h"
 
+#include "Limoncello/Analysis/FunctionSelection.h"
+#include "Limoncello/Analysis/ObfuscationCost.h"
 #include "Limoncello/Config/Config.h"
+#include "Limoncello/Support/DispatchProfile.h"
 #include "Limoncello/Support/Function.h"
+#include "Limoncello/Support/Module.h"
 #include "Limoncello/Support/Random.h"
+#include "Limoncello/Support/Report.h"
 
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/OptimizationRemarkEmitter.h>
+#include <llvm/IR/CFG.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/Dominators.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/Support/RandomNumberGenerator.h>
 #include <llvm/Transforms/Utils/Local.h>
 
+#include <numeric>
+
+#define DEBUG_TYPE "flattener"
+
+STATISTIC(NumFunctionsFlattened, "Number of functions flattened");
+STATISTIC(NumFunctionsSkipped, "Number of functions not flattened");
+STATISTIC(NumBlocksFlattened, "Number of blocks moved behind a dispatcher");
+STATISTIC(NumRegions, "Number of regions with their own dispatcher");
+STATISTIC(NumInstructionsAdded, "Number of instructions added");
+STATISTIC(NumValuesDemoted, "Number of values demoted to the stack");
+
 using namespace llvm;
 
-StateMachine::StateMachine(BasicBlock *eb) : m_entryBlock(eb) {
+StateMachine::StateMachine(BasicBlock *eb, unsigned numStates)
+    : m_entryBlock(eb) {
   auto &ctx = m_entryBlock->getContext();
   auto func = m_entryBlock->getParent();
 
@@ -46,7 +69,24 @@ StateMachine::StateMachine(BasicBlock *eb) : m_entryBlock(eb) {
   IRBuilder<> dispatchBuilder(m_switchBlock);
   auto switchValue = dispatchBuilder.CreateLoad(dispatchBuilder.getInt32Ty(),
                                                 m_stateVar, "state");
-  m_switchInst = dispatchBuilder.CreateSwitch(switchValue, m_defaultBlock);
+  m_switchInst =
+      dispatchBuilder.CreateSwitch(switchValue, m_defaultBlock, numStates);
+
+  // State IDs always form a dense range, so the dispatcher can be lowered to
+  // a jump table. With random IDs, the range starts at a random offset and is
+  // handed out in a random order (a Fisher-Yates shuffle), which can't ever
+  // produce the same ID twice.
+  auto const &config = Config::get()->flattener;
+  m_firstStateId = 1;
+  if (config.useRandomCaseIds && config.maxRandomCases > 0)
+    m_firstStateId = getRandomInt32() % config.maxRandomCases;
+
+  m_stateIds.resize(numStates);
+  std::iota(m_stateIds.begin(), m_stateIds.end(), m_firstStateId);
+  if (config.useRandomCaseIds) {
+    for (size_t i = m_stateIds.size(); i > 1; --i)
+      std::swap(m_stateIds[i - 1], m_stateIds[getRandomInt64() % i]);
+  }
 }
 
 bool StateMachine::shouldIgnoreTerminator(Instruction *instruction) {
@@ -56,50 +96,57 @@ bool StateMachine::shouldIgnoreTerminator(Instruction *instruction) {
   return false;
 }
 
-/// Maximum number of times a case ID should be generated before giving up.
-constexpr auto MaxRandomCaseIDAttempts = 3;
+ConstantInt *StateMachine::assignStateId(BasicBlock *block) {
+  assert(m_blockStateIds.size() < m_stateIds.size() &&
+         "Added more states than the state machine has room for");
 
-void StateMachine::addState(BasicBlock *block) const {
-  auto config = Config::get();
+  auto stateId = ConstantInt::get(Type::getInt32Ty(block->getContext()),
+                                  m_stateIds[m_blockStateIds.size()]);
+  m_blockStateIds[block] = stateId;
+  return stateId;
+}
 
-  auto getConstantInt32 = [this](uint32_t value) {
-    auto &context = m_switchInst->getContext();
-    return ConstantInt::get(Type::getInt32Ty(context), value);
-  };
+void StateMachine::addState(BasicBlock *block) {
+  auto stateId = assignStateId(block);
 
-  auto stateId = m_switchInst->getNumCases() + 1;
-  if (config->flattener.useRandomCaseIds) {
-    // We need to make sure that the state ID we just generated are unique,
-    // otherwise we'll end up creating two cases with the same ID, which
-    // becomes more likely in sufficiently large functions.
-    //
-    // That said, an infinite loop here would be dangerous and who doesn't like
-    // a bit of gambling; will the RNG succeed within the number of allowed
-    // attempts or will you have to recompile?
-    int attempts = 0;
-    while (attempts < MaxRandomCaseIDAttempts) {
-      stateId = getRandomInt32() % config->flattener.maxRandomCases;
-
-      auto state = getConstantInt32(stateId);
-      if (m_switchInst->findCaseValue(state) != m_switchInst->case_default()) {
-        ++attempts;
-        continue;
-      }
+  block->moveBefore(m_endBlock);
+  m_switchInst->addCase(stateId, block);
+}
 
-      break;
-    }
+void StateMachine::addRegion(ArrayRef<BasicBlock *> blocks) {
+  auto &ctx = m_entryBlock->getContext();
+  auto func = m_entryBlock->getParent();
 
-    // If this is a debug build then we'll get a nice message here, otherwise
-    // the verifier pass (or some other part of LLVM) will eventually cry about
-    // this; in either case, compiliation won't succeed and this will
-    // eventually be communicated to the user.
-    if (attempts == MaxRandomCaseIDAttempts) {
-      assert(0 && "Failed to generate unique case ID for switch");
-    }
+  // The region's blocks are laid out right after its dispatcher, so that
+  // transitions within the region stay close together.
+  auto dispatcher = BasicBlock::Create(ctx, "fsmRegion", func, m_endBlock);
+  IRBuilder<> builder(dispatcher);
+  auto state = builder.CreateLoad(builder.getInt32Ty(), m_stateVar, "state");
+  auto regionSwitch =
+      builder.CreateSwitch(state, m_defaultBlock, blocks.size());
+
+  for (auto block : blocks) {
+    auto stateId = assignStateId(block);
+    m_blockDispatchers[block] = dispatcher;
+
+    block->moveBefore(m_endBlock);
+    m_switchInst->addCase(stateId, dispatcher);
+    regionSwitch->addCase(stateId, block);
   }
+}
 
-  block->moveBefore(m_endBlock);
-  m_switchInst->addCase(getConstantInt32(stateId), block);
+ConstantInt *StateMachine::getStateId(BasicBlock *block) const {
+  auto it = m_blockStateIds.find(block);
+  assert(it != m_blockStateIds.end() && "Block is not part of state machine");
+  return it->second;
+}
+
+BasicBlock *StateMachine::getDispatcher(BasicBlock *block) const {
+  auto it = m_blockDispatchers.find(block);
+  if (it == m_blockDispatchers.end())
+    return m_endBlock;
+
+  return it->second;
 }
 
 void StateMachine::rewriteBranch(BranchInst *branchInst) {
@@ -109,29 +156,96 @@ void StateMachine::rewriteBranch(BranchInst *branchInst) {
     auto trueDest = branchInst->getSuccessor(0);
     auto falseDest = branchInst->getSuccessor(1);
 
-    auto trueDestId = m_switchInst->findCaseDest(trueDest);
-    auto falseDestId = m_switchInst->findCaseDest(falseDest);
+    auto trueDestId = getStateId(trueDest);
+    auto falseDestId = getStateId(falseDest);
 
     IRBuilder<> builder(block);
     auto nextStateId = builder.CreateSelect(branchInst->getCondition(),
                                             trueDestId, falseDestId);
-    builder.CreateStore(nextStateId, m_stateVar);
-    builder.CreateBr(m_endBlock);
+    createTransition(builder, nextStateId, {trueDest, falseDest});
   } else {
     auto dest = branchInst->getSuccessor(0);
     if (dest == m_endBlock)
       return;
 
-    auto destId = m_switchInst->findCaseDest(dest);
+    auto destId = getStateId(dest);
 
     IRBuilder<> builder(block);
-    builder.CreateStore(destId, m_stateVar);
-    builder.CreateBr(m_endBlock);
+    createTransition(builder, destId, {dest});
   }
 
   branchInst->eraseFromParent();
 }
 
+void StateMachine::createJumpTable() {
+  auto func = m_entryBlock->getParent();
+  auto &module = *func->getParent();
+
+  SmallVector<Constant *> addresses(m_stateIds.size());
+  for (auto [block, stateId] : m_blockStateIds)
+    addresses[stateId->getZExtValue() - m_firstStateId] =
+        BlockAddress::get(func, block);
+
+  auto tableType =
+      ArrayType::get(PointerType::getUnqual(module.getContext()),
+                     addresses.size());
+  m_jumpTable = new GlobalVariable(
+      module, tableType, /*isConstant=*/false,
+      Config::get()->getDefaultLinkage(),
+      ConstantArray::get(tableType, addresses),
+      getModuleSpecificName(module, "__lmcoFlattenerJumpTable"));
+}
+
+void StateMachine::createTransition(IRBuilder<> &builder, Value *stateId,
+                                    ArrayRef<BasicBlock *> dests) {
+  builder.CreateStore(stateId, m_stateVar);
+
+  if (m_jumpTable) {
+    // Every block gets an indirect branch of its own, which the branch
+    // predictor can then track separately. The load is volatile, as the
+    // optimizer would otherwise see right through the table (which is never
+    // written to) and turn this back into a plain branch.
+    auto tableType = m_jumpTable->getValueType();
+    auto index = builder.CreateZExt(
+        builder.CreateSub(stateId, builder.getInt32(m_firstStateId)),
+        builder.getInt64Ty());
+    auto entry = builder.CreateInBoundsGEP(tableType, m_jumpTable,
+                                           {builder.getInt64(0), index});
+    auto address = builder.CreateLoad(tableType->getArrayElementType(), entry,
+                                      /*isVolatile=*/true);
+
+    auto branch = builder.CreateIndirectBr(address, dests.size());
+    SmallPtrSet<BasicBlock *, 2> added;
+    for (auto dest : dests) {
+      if (added.insert(dest).second)
+        branch->addDestination(dest);
+    }
+
+    return;
+  }
+
+  // If all destinations are in the same region, its dispatcher can be used
+  // directly; otherwise, the top-level dispatcher has to pick the region.
+  auto dispatcher = getDispatcher(dests.front());
+  for (auto dest : dests.drop_front()) {
+    if (getDispatcher(dest) != dispatcher)
+      dispatcher = m_endBlock;
+  }
+
+  builder.CreateBr(dispatcher);
+}
+
+void StateMachine::eraseDispatcher() {
+  if (!pred_empty(m_endBlock))
+    return;
+
+  m_endBlock->eraseFromParent();
+  m_switchBlock->eraseFromParent();
+  m_defaultBlock->eraseFromParent();
+  m_switchInst = nullptr;
+  m_endBlock = m_switchBlock = m_defaultBlock = nullptr;
+}
+
 void StateMachine::rewriteBlock(BasicBlock *block) {
   auto termInst = block->getTerminator();
   if (shouldIgnoreTerminator(termInst))
@@ -150,7 +264,19 @@ void StateMachine::finalize(BasicBlock *firstBlock,
                             SmallVector<BasicBlock *> const &flatteningSet) {
   IRBuilder<> entryBuilder(m_entryBlock);
 
-  auto stateId = m_switchInst->findCaseDest(firstBlock);
+  if (Config::get()->flattener.useThreadedDispatch) {
+    // Nothing goes through the shared dispatcher anymore, not even the entry
+    // block.
+    createJumpTable();
+    createTransition(entryBuilder, getStateId(firstBlock), {firstBlock});
+    for (auto block : flatteningSet)
+      rewriteBlock(block);
+
+    eraseDispatcher();
+    return;
+  }
+
+  auto stateId = getStateId(firstBlock);
   entryBuilder.CreateStore(stateId, m_stateVar);
 
   for (auto block : flatteningSet)
@@ -173,24 +299,79 @@ SmallVector<BasicBlock *> FlattenerPass::getFlatteningSet(Function &func) {
   return result;
 }
 
-BlockPair FlattenerPass::splitConditionalPart(BasicBlock *block) {
-  auto terminator = block->getTerminator();
+SmallVector<SmallVector<BasicBlock *>>
+FlattenerPass::getRegions(Function &func,
+                          SmallVector<BasicBlock *> const &flatteningSet,
+                          unsigned regionSize) {
+  SmallPtrSet<BasicBlock *, 32> unassigned(flatteningSet.begin(),
+                                           flatteningSet.end());
+  DominatorTree domTree(func);
+
+  // Walking the dominator tree bottom-up, blocks are accumulated into their
+  // dominators until a subtree holds enough of them to form a region. Loops
+  // end up in the same region as long as they fit, since every block in a
+  // loop is dominated by its header.
+  SmallVector<SmallVector<BasicBlock *>> regions;
+  DenseMap<DomTreeNode *, SmallVector<BasicBlock *>> pending;
+  for (auto node : post_order(domTree.getRootNode())) {
+    SmallVector<BasicBlock *> blocks;
+    if (unassigned.count(node->getBlock()))
+      blocks.emplace_back(node->getBlock());
+
+    for (auto child : node->children()) {
+      auto it = pending.find(child);
+      if (it == pending.end())
+        continue;
 
-  Instruction *splitPoint = nullptr;
-  if (auto branchInst = dyn_cast<BranchInst>(terminator)) {
-    if (branchInst->isConditional()) {
-      auto condition = branchInst->getCondition();
-      auto conditionInst = dyn_cast<Instruction>(condition);
-      assert(conditionInst && "Found conditional branch without condition");
-
-      splitPoint = conditionInst;
-    } else {
-      splitPoint = terminator;
+      blocks.append(it->second);
+      pending.erase(it);
+    }
+
+    if (blocks.size() < regionSize) {
+      if (!blocks.empty())
+        pending[node] = std::move(blocks);
+      continue;
     }
-  } else if (auto switchInst = dyn_cast<SwitchInst>(terminator)) {
-    splitPoint = switchInst;
+
+    for (auto block : blocks)
+      unassigned.erase(block);
+    regions.emplace_back(std::move(blocks));
+  }
+
+  // Whatever is left (blocks close to the root, and unreachable blocks which
+  // aren't in the dominator tree at all) forms the final region.
+  SmallVector<BasicBlock *> remaining;
+  for (auto block : flatteningSet) {
+    if (unassigned.count(block))
+      remaining.emplace_back(block);
   }
+  if (!remaining.empty())
+    regions.emplace_back(std::move(remaining));
+
+  return regions;
+}
 
+Instruction *FlattenerPass::getConditionalPartStart(BasicBlock *block) {
+  auto terminator = block->getTerminator();
+  if (auto branchInst = dyn_cast<BranchInst>(terminator)) {
+    if (!branchInst->isConditional())
+      return terminator;
+
+    auto condition = branchInst->getCondition();
+    auto conditionInst = dyn_cast<Instruction>(condition);
+    assert(conditionInst && "Found conditional branch without condition");
+
+    return conditionInst;
+  }
+
+  if (auto switchInst = dyn_cast<SwitchInst>(terminator))
+    return switchInst;
+
+  return nullptr;
+}
+
+BlockPair FlattenerPass::splitConditionalPart(BasicBlock *block) {
+  auto splitPoint = getConditionalPartStart(block);
   if (!splitPoint)
     return {block, nullptr};
 
@@ -198,31 +379,159 @@ BlockPair FlattenerPass::splitConditionalPart(BasicBlock *block) {
   return {block, conditionalPart};
 }
 
+bool FlattenerPass::shouldRunOnFunction(Function &func,
+                                        FunctionAnalysisManager &fam) {
+  auto &config = Config::get()->flattener;
+
+  // Module analyses can't be computed from inside a function pass, so the
+  // selection is only used if it was already computed; the pipeline takes
+  // care of requiring it ahead of this pass.
+  auto &moduleProxy = fam.getResult<ModuleAnalysisManagerFunctionProxy>(func);
+  if (auto selection = moduleProxy.getCachedResult<FunctionSelectionAnalysis>(
+          *func.getParent()))
+    return selection->shouldRunOnFunction(config, func);
+
+  return config.shouldRunOnFunction(func);
+}
+
+/// Estimated number of instructions added each time a flattened block is
+/// entered, i.e. storing the next state and going through the dispatcher.
+static constexpr double FlattenedBlockCost = 6;
+
+bool FlattenerPass::canAffordFlattening(Function &func,
+                                        FunctionAnalysisManager &fam,
+                                        StringRef &reason) {
+  auto &moduleProxy = fam.getResult<ModuleAnalysisManagerFunctionProxy>(func);
+  auto cost = moduleProxy.getCachedResult<ObfuscationCostAnalysis>(
+      *func.getParent());
+  if (!cost)
+    return true;
+
+  auto costModel = cost->getModel(func, fam);
+  if (costModel.isFunctionHot()) {
+    reason = "hot";
+    return false;
+  }
+
+  // Every transition between blocks goes through the dispatcher afterwards,
+  // so flattening can't be thinned out; it's all or nothing.
+  double totalCost = 0;
+  for (auto &block : func) {
+    if (costModel.isBlockHot(block)) {
+      reason = "hot block";
+      return false;
+    }
+
+    totalCost += FlattenedBlockCost * costModel.getRelativeFrequency(block);
+  }
+
+  if (!costModel.trySpend(totalCost)) {
+    reason = "over budget";
+    return false;
+  }
+
+  return true;
+}
+
 PreservedAnalyses FlattenerPass::run(Function &func,
-                                     FunctionAnalysisManager &) {
-  if (!Config::get()->flattener.shouldRunOnFunction(func))
+                                     FunctionAnalysisManager &fam) {
+  if (func.isDeclaration())
+    return PreservedAnalyses::all();
+
+  auto &ore = fam.getResult<OptimizationRemarkEmitterAnalysis>(func);
+  auto skip = [&](StringRef reason) {
+    reportSkippedFunction(ore, DEBUG_TYPE, func, reason);
+    ++NumFunctionsSkipped;
+  };
+
+  if (!shouldRunOnFunction(func, fam)) {
+    skip("not selected");
     return PreservedAnalyses::all();
+  }
 
   // TODO: Support C++ exceptions.
   for (auto &block : func) {
     if (block.isLandingPad()) {
+      skip("has landing pads");
       return PreservedAnalyses::all();
     }
   }
 
+  // Flattening is all or nothing, so a single hot state is enough to leave
+  // the whole function alone.
+  auto profile = DispatchProfile::get();
+  if (profile &&
+      profile->hasHotPoints(DispatchPointKind::FlattenerState, func)) {
+    skip("hot in dispatch profile");
+    return PreservedAnalyses::all();
+  }
+
+  // Every block but the entry block becomes a state, along with the
+  // conditional part split off the entry block (if any). Functions left alone
+  // shouldn't pay for flattening, so this is checked before anything is split
+  // (or charged to the budget).
+  auto numStates = func.size() - 1;
+  if (getConditionalPartStart(&func.getEntryBlock()))
+    ++numStates;
+  if (numStates < 2) {
+    skip("too few blocks");
+    return PreservedAnalyses::all();
+  }
+
+  StringRef reason;
+  if (!canAffordFlattening(func, fam, reason)) {
+    skip(reason);
+    return PreservedAnalyses::all();
+  }
+
+  auto instructionsBefore = func.getInstructionCount();
   auto [entryBlock, trailingConditionalBlock] =
       splitConditionalPart(&func.getEntryBlock());
   auto flatteningSet = getFlatteningSet(func);
-  if (flatteningSet.size() < 2)
-    return PreservedAnalyses::none();
-
-  StateMachine stateMachine(entryBlock);
-  for (auto block : flatteningSet)
-    stateMachine.addState(block);
+  assert(flatteningSet.size() == numStates && "Mispredicted state count");
+
+  // Regions have to be found before the state machine starts rewriting the
+  // entry block.
+  auto const &config = Config::get()->flattener;
+  SmallVector<SmallVector<BasicBlock *>> regions;
+  if (config.useRegions && !config.useThreadedDispatch &&
+      config.regionSize > 1 && flatteningSet.size() > config.regionSize)
+    regions = getRegions(func, flatteningSet, config.regionSize);
+
+  RandomStreamScope randomScope("flattener", func.getName());
+  StateMachine stateMachine(entryBlock, flatteningSet.size());
+  if (!regions.empty()) {
+    for (auto const &region : regions)
+      stateMachine.addRegion(region);
+  } else {
+    for (auto block : flatteningSet)
+      stateMachine.addState(block);
+  }
 
   stateMachine.finalize(trailingConditionalBlock, flatteningSet);
 
-  repairSSA(func);
+  auto numDemoted = repairSSA(func);
+
+  // Every state is only ever entered through a dispatcher, so counting state
+  // entries counts dispatches, and tells which states they go to.
+  if (Config::get()->dispatchProfile.instrument) {
+    for (unsigned i = 0; i < flatteningSet.size(); ++i) {
+      IRBuilder<> builder(&*flatteningSet[i]->getFirstInsertionPt());
+      insertDispatchCounter(builder, DispatchPointKind::FlattenerState, i);
+    }
+  }
+
+  auto instructionsAfter = func.getInstructionCount();
+  reportObfuscatedFunction(ore, DEBUG_TYPE, func, instructionsBefore,
+                           instructionsAfter,
+                           {{"blocks", flatteningSet.size()},
+                            {"regions", regions.size()},
+                            {"values-demoted", numDemoted}});
+  ++NumFunctionsFlattened;
+  NumBlocksFlattened += flatteningSet.size();
+  NumRegions += regions.size();
+  NumValuesDemoted += numDemoted;
+  NumInstructionsAdded += instructionsAfter - instructionsBefore;
 
   return PreservedAnalyses::none();
 }
@@ -0,0 +1,224 @@
+//===-- Pass/ParallelDriver.cpp - Split-module parallel obfuscation -------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Pass/ParallelDriver.h"
+
+#include "Limoncello/Analysis/FunctionSelection.h"
+#include "Limoncello/Analysis/ObfuscationCost.h"
+#include "Limoncello/Config/FunctionOverride.h"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+
+#include <mutex>
+
+using namespace llvm;
+
+namespace {
+
+/// Diagnostic handler for partition contexts, passing everything on to the
+/// context of the module being split; this is where remarks are enabled (and
+/// streamed to a file, if requested).
+class ForwardingDiagnosticHandler : public DiagnosticHandler {
+  LLVMContext &m_parent;
+
+  /// Guards the parent context, whose handler and remark streamer aren't
+  /// meant to be used from several threads at once.
+  static std::mutex s_mutex;
+
+  DiagnosticHandler const &getParentHandler() const {
+    return *m_parent.getDiagHandlerPtr();
+  }
+
+public:
+  explicit ForwardingDiagnosticHandler(LLVMContext &parent)
+      : m_parent(parent) {}
+
+  bool handleDiagnostics(DiagnosticInfo const &info) override {
+    std::lock_guard lock(s_mutex);
+    m_parent.diagnose(info);
+    return true;
+  }
+
+  bool isAnalysisRemarkEnabled(StringRef pass) const override {
+    return getParentHandler().isAnalysisRemarkEnabled(pass);
+  }
+  bool isMissedOptRemarkEnabled(StringRef pass) const override {
+    return getParentHandler().isMissedOptRemarkEnabled(pass);
+  }
+  bool isPassedOptRemarkEnabled(StringRef pass) const override {
+    return getParentHandler().isPassedOptRemarkEnabled(pass);
+  }
+
+  // Remarks streamed to a file are emitted regardless of the handler, so
+  // passes need to produce them whenever the parent has a streamer.
+  bool isAnyRemarkEnabled() const override {
+    return m_parent.getLLVMRemarkStreamer() ||
+           getParentHandler().isAnyRemarkEnabled();
+  }
+};
+
+std::mutex ForwardingDiagnosticHandler::s_mutex;
+
+} // namespace
+
+/// Erase all named metadata from \p module except for the nodes in \p keep.
+static void eraseNamedMetadata(Module &module, ArrayRef<StringRef> keep) {
+  SmallVector<NamedMDNode *> erased;
+  for (auto &node : module.named_metadata())
+    if (!is_contained(keep, node.getName()))
+      erased.emplace_back(&node);
+
+  for (auto node : erased)
+    module.eraseNamedMetadata(node);
+}
+
+ParallelDriverPass::ParallelDriverPass(unsigned partitions, unsigned threads,
+                                       BuildPipelineCallback buildPipeline)
+    : m_partitions(partitions), m_threads(threads),
+      m_buildPipeline(std::move(buildPipeline)) {}
+
+SmallString<0>
+ParallelDriverPass::obfuscatePartition(StringRef bitcode, StringRef identifier,
+                                       LLVMContext &parentContext) const {
+  // Every partition gets a context of its own, since contexts can't be shared
+  // between threads. The module identifier is carried over as-is, as it is
+  // used to salt the names of generated symbols.
+  LLVMContext context;
+  context.setDiagnosticHandler(
+      std::make_unique<ForwardingDiagnosticHandler>(parentContext));
+  context.setDiagnosticsHotnessRequested(
+      parentContext.getDiagnosticsHotnessRequested());
+  context.setDiagnosticsHotnessThreshold(
+      parentContext.getDiagnosticsHotnessThreshold());
+  auto partition =
+      parseBitcodeFile(MemoryBufferRef(bitcode, identifier), context);
+  if (!partition)
+    report_fatal_error(partition.takeError());
+
+  LoopAnalysisManager lam;
+  FunctionAnalysisManager fam;
+  CGSCCAnalysisManager cgam;
+  ModuleAnalysisManager mam;
+
+  PassBuilder builder;
+  builder.registerModuleAnalyses(mam);
+  builder.registerCGSCCAnalyses(cgam);
+  builder.registerFunctionAnalyses(fam);
+  builder.registerLoopAnalyses(lam);
+  builder.crossRegisterProxies(lam, fam, cgam, mam);
+  mam.registerPass([] { return FunctionSelectionAnalysis(); });
+  mam.registerPass([] { return ObfuscationCostAnalysis(); });
+
+  ModulePassManager manager;
+  m_buildPipeline(manager);
+  manager.run(**partition, mam);
+
+  SmallString<0> result;
+  raw_svector_ostream stream(result);
+  WriteBitcodeToFile(**partition, stream);
+
+  return result;
+}
+
+void ParallelDriverPass::clearModule(Module &module) {
+  // Globals can refer to each other (and to functions) in arbitrary ways, so
+  // all references need to be dropped before anything can be erased.
+  for (auto &func : module)
+    func.dropAllReferences();
+  for (auto &var : module.globals())
+    var.dropAllReferences();
+  for (auto &alias : module.aliases())
+    alias.dropAllReferences();
+  for (auto &ifunc : module.ifuncs())
+    ifunc.dropAllReferences();
+
+  auto eraseAll = [](auto &&values) {
+    for (auto it = values.begin(); it != values.end();) {
+      auto &value = *it++;
+      value.removeDeadConstantUsers();
+      value.eraseFromParent();
+    }
+  };
+  eraseAll(module.aliases());
+  eraseAll(module.ifuncs());
+  eraseAll(module.functions());
+  eraseAll(module.globals());
+
+  // Module flags are merged when linking, but everything else (identification,
+  // compile units, inline assembly, etc.) will be brought back by the
+  // partitions.
+  eraseNamedMetadata(module, {"llvm.module.flags"});
+  module.setModuleInlineAsm("");
+}
+
+PreservedAnalyses ParallelDriverPass::run(Module &module,
+                                          ModuleAnalysisManager &) {
+  auto identifier = module.getModuleIdentifier();
+
+  // Annotations live in a single global array, which can only end up in one
+  // partition; overrides given through them have to travel with each function
+  // instead.
+  copyOverrideAnnotationsToAttributes(module);
+
+  // Locals are kept in the same partition as their users, rather than being
+  // externalized; otherwise linkage in the final output would change, and
+  // string globals would no longer be eligible for obfuscation.
+  //
+  // Each partition is a full clone of the module's named metadata and inline
+  // assembly, which only need to be linked back in once (the linker appends
+  // the assembly of every module), except for the compile units referenced by
+  // each partition's debug info.
+  SmallVector<SmallString<0>> inputs;
+  SplitModule(
+      module, m_partitions,
+      [&](std::unique_ptr<Module> partition) {
+        if (!inputs.empty()) {
+          eraseNamedMetadata(*partition, {"llvm.module.flags", "llvm.dbg.cu"});
+          partition->setModuleInlineAsm("");
+        }
+
+        raw_svector_ostream stream(inputs.emplace_back());
+        WriteBitcodeToFile(*partition, stream);
+      },
+      /*PreserveLocals=*/true);
+
+  SmallVector<SmallString<0>> outputs(inputs.size());
+  ThreadPool pool(hardware_concurrency(m_threads));
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    pool.async([this, &inputs, &outputs, &identifier, &module, i] {
+      outputs[i] =
+          obfuscatePartition(inputs[i], identifier, module.getContext());
+    });
+  }
+  pool.wait();
+
+  // Partitions are always linked back in the same order, regardless of which
+  // order they finished in.
+  clearModule(module);
+  Linker linker(module);
+  for (auto const &output : outputs) {
+    auto partition = parseBitcodeFile(MemoryBufferRef(output, identifier),
+                                      module.getContext());
+    if (!partition)
+      report_fatal_error(partition.takeError());
+
+    if (linker.linkInModule(std::move(*partition)))
+      report_fatal_error("Limoncello: Failed to link obfuscated partition");
+  }
+
+  return PreservedAnalyses::none();
+}
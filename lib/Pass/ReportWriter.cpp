@@ -0,0 +1,37 @@
+//===-- Pass/ReportWriter.cpp - Obfuscation report output -----------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Pass/ReportWriter.h"
+
+#include "Limoncello/Support/Report.h"
+
+#include <llvm/ADT/ScopeExit.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+PreservedAnalyses ReportWriterPass::run(Module &module,
+                                        ModuleAnalysisManager &) {
+  // The records are process-wide; whatever happens, this module's records
+  // must not end up in the report of the next module run in this process.
+  auto clearOnExit = make_scope_exit(clearReport);
+
+  std::error_code error;
+  raw_fd_ostream os(m_path, error, sys::fs::OF_Text);
+  if (error) {
+    errs() << "Limoncello: Failed to write report to " << m_path << ": "
+           << error.message() << "\n";
+    return PreservedAnalyses::all();
+  }
+
+  writeReport(os, module.getSourceFileName());
+  return PreservedAnalyses::all();
+}
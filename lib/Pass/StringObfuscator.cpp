@@ -9,27 +9,88 @@
 
 #include "Limoncello/Pass/StringObfuscator.h"
 
+#include "Limoncello/Analysis/FunctionSelection.h"
+#include "Limoncello/Config/Config.h"
 #include "Limoncello/Support/Function.h"
 #include "Limoncello/Support/Module.h"
 #include "Limoncello/Support/Random.h"
+#include "Limoncello/Support/Report.h"
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/OptimizationRemarkEmitter.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InstIterator.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/ValueHandle.h>
 #include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
 #include <llvm/Support/RandomNumberGenerator.h>
 #include <llvm/Support/SourceMgr.h>
+#include <llvm/TargetParser/Triple.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Transforms/Utils/ModuleUtils.h>
 
+#include <map>
+#include <mutex>
+
 #include "StringObfuscatorBitcode.h"
 
+#define DEBUG_TYPE "string-obfuscator"
+
+STATISTIC(NumStringsObfuscated, "Number of strings obfuscated");
+STATISTIC(NumStringBytesEncrypted,
+          "Number of bytes of string contents encrypted");
+STATISTIC(NumStringsSkipped,
+          "Number of strings skipped since no selected function uses them");
+STATISTIC(NumStringsDeduplicated,
+          "Number of strings merged into an identical string");
+STATISTIC(NumStringTableBytes, "Size of the packed string table in bytes");
+STATISTIC(NumStringTablePages, "Most pages the packed string table can span");
+
 constexpr auto FunctionNameDeobfuscate = "__lmcoStringDeobfuscateXOR";
+constexpr auto FunctionNameRuntimePortable = "deobfuscateXORPortable";
 constexpr auto FunctionNameDeobfuscateAll = "__lmcoStringDeobfuscateAll";
+constexpr auto FunctionNameLazyAccess = "__lmcoStringAccess";
+constexpr auto FunctionNameLazyInit = "__lmcoStringInit";
+constexpr auto GlobalNameLazyOnceFlag = "__lmcoStringOnce";
+constexpr auto GlobalNameStringData = "__lmcoStringData";
+constexpr auto GlobalNameStringTable = "__lmcoStringTable";
+
+/// Alignment (and size granularity) of a page-aligned string table; this is the
+/// smallest page size of any common target.
+constexpr uint64_t StringTablePageSize = 4096;
+
+/// States of the once-flag guarding a group of lazily-decrypted strings.
+enum LazyState : uint8_t {
+  LazyStateEncrypted = 0,
+  LazyStateDecrypting = 1,
+  LazyStateDecrypted = 2,
+};
 
 using namespace llvm;
 
+/// Get the most pages a string table of \p tableSize bytes can span. Unless
+/// the table is page-aligned, it may start anywhere within a page, and so
+/// spill over into one more page than its size alone would need.
+static uint64_t getStringTablePages(uint64_t tableSize) {
+  if (tableSize == 0)
+    return 0;
+
+  if (Config::get()->stringObfuscator.isTablePageAligned)
+    return divideCeil(tableSize, StringTablePageSize);
+
+  return 1 + divideCeil(tableSize - 1, StringTablePageSize);
+}
+
 Constant *StringObfuscatorPass::createObfuscatedString(LLVMContext &context,
                                                        StringRef content,
                                                        uint8_t key) {
@@ -40,10 +101,191 @@ Constant *StringObfuscatorPass::createObfuscatedString(LLVMContext &context,
   return ConstantDataArray::getString(context, StringRef(result), false);
 }
 
+/// Tells whether \p value is used by any function selected by \p selection,
+/// either directly or through constant expressions.
+///
+/// Uses in the initializers of other globals are followed as well, so that
+/// e.g. strings in a table indexed by a selected function are included.
+static bool isUsedBySelectedFunction(Value *value,
+                                     FunctionSelection const &selection,
+                                     SmallPtrSetImpl<Value *> &visited) {
+  auto const &config = Config::get()->stringObfuscator;
+  for (auto user : value->users()) {
+    if (!visited.insert(user).second)
+      continue;
+
+    if (auto inst = dyn_cast<Instruction>(user)) {
+      if (selection.shouldRunOnFunction(config, *inst->getFunction()))
+        return true;
+      continue;
+    }
+
+    if (isa<Function>(user) || !isa<Constant>(user))
+      continue;
+    if (isUsedBySelectedFunction(user, selection, visited))
+      return true;
+  }
+
+  return false;
+}
+
+/// Add every function using \p value, either directly or through constants, to
+/// \p users.
+static void collectUsingFunctions(Value *value,
+                                  SmallSetVector<Function *, 4> &users,
+                                  SmallPtrSetImpl<Value *> &visited) {
+  for (auto user : value->users()) {
+    if (!visited.insert(user).second)
+      continue;
+
+    if (auto inst = dyn_cast<Instruction>(user))
+      users.insert(inst->getFunction());
+    else if (isa<Constant>(user) && !isa<GlobalValue>(user))
+      collectUsingFunctions(user, users, visited);
+  }
+}
+
+/// Emit a remark on each function using any of the strings in \p records,
+/// telling how many of them (and how many bytes) were obfuscated.
+///
+/// Remarks need a function to be attached to; strings which no function uses
+/// directly (e.g. ones only referenced by other globals) are left out.
+static void
+emitStringRemarks(Module &module, FunctionAnalysisManager &fam,
+                  std::vector<ObfuscatedStringRecord> const &records) {
+  // Finding the users of every string isn't free, so only do it if anyone is
+  // listening.
+  auto &context = module.getContext();
+  if (!context.getLLVMRemarkStreamer() &&
+      !context.getDiagHandlerPtr()->isAnyRemarkEnabled(DEBUG_TYPE))
+    return;
+
+  MapVector<Function *, std::pair<uint64_t, uint64_t>> counts;
+  for (auto const &record : records) {
+    SmallSetVector<Function *, 4> users;
+    SmallPtrSet<Value *, 8> visited;
+    collectUsingFunctions(record.handle, users, visited);
+    for (auto func : users) {
+      auto &[numStrings, numBytes] = counts[func];
+      ++numStrings;
+      numBytes += record.size;
+    }
+  }
+
+  for (auto const &entry : counts) {
+    auto func = entry.first;
+    auto numStrings = entry.second.first;
+    auto numBytes = entry.second.second;
+    auto &ore = fam.getResult<OptimizationRemarkEmitterAnalysis>(*func);
+    ore.emit([&] {
+      return OptimizationRemark(DEBUG_TYPE, "Obfuscated", func)
+             << "obfuscated " << ore::NV("Strings", numStrings)
+             << " strings used here (" << ore::NV("Bytes", numBytes)
+             << " bytes)";
+    });
+  }
+}
+
+/// Tells whether \p var can be folded into the packed string table, i.e. it
+/// is only referenced from within the module and has no placement constraints
+/// of its own.
+static bool canPackString(GlobalVariable const &var,
+                          SmallPtrSetImpl<GlobalValue *> const &usedGlobals) {
+  return var.hasLocalLinkage() && !var.hasSection() && !var.hasComdat() &&
+         !var.isThreadLocal() &&
+         !usedGlobals.count(const_cast<GlobalVariable *>(&var));
+}
+
+uint64_t StringObfuscatorPass::packStrings(
+    Module &module, ArrayRef<GlobalVariable *> strings,
+    std::vector<ObfuscatedStringRecord> &records) {
+  if (strings.empty())
+    return 0;
+
+  auto &context = module.getContext();
+  auto int8Ty = Type::getInt8Ty(context);
+  auto addPadding = [&](SmallVectorImpl<Constant *> &fields, uint64_t size) {
+    if (size != 0)
+      fields.emplace_back(
+          ConstantAggregateZero::get(ArrayType::get(int8Ty, size)));
+  };
+
+  // Each string keeps its own alignment (instructions referencing it may rely
+  // on it), so explicit padding is inserted between strings as needed.
+  SmallVector<Constant *> fields;
+  SmallVector<std::tuple<unsigned, size_t, uint8_t>> layout;
+  uint64_t offset = 0;
+  Align tableAlign;
+  for (auto var : strings) {
+    auto data = cast<ConstantDataArray>(var->getInitializer());
+    auto content = data->getAsString();
+
+    tableAlign = std::max(tableAlign, var->getAlign().valueOrOne());
+    auto alignedOffset = alignTo(offset, var->getAlign().valueOrOne());
+    addPadding(fields, alignedOffset - offset);
+    offset = alignedOffset + content.size();
+
+    RandomStreamScope randomScope("string-obfuscator", var->getName());
+    uint8_t xorKey = getRandomInt8();
+
+    // The null byte is included in `content.size()` and should not be touched
+    // when deobfuscating strings.
+    layout.emplace_back(fields.size(), content.size() - 1, xorKey);
+    fields.emplace_back(createObfuscatedString(context, content, xorKey));
+  }
+
+  // If asked to, pad the table out to a whole number of pages, so that no
+  // other data shares (and is made private by the dirtying of) its pages.
+  auto tableSize = offset;
+  if (Config::get()->stringObfuscator.isTablePageAligned) {
+    tableAlign = Align(StringTablePageSize);
+    tableSize = alignTo(offset, StringTablePageSize);
+    addPadding(fields, tableSize - offset);
+  }
+
+  auto tableInit = ConstantStruct::getAnon(context, fields, /*Packed=*/true);
+  auto table = new GlobalVariable(
+      module, tableInit->getType(), /*isConstant=*/false,
+      Config::get()->getDefaultLinkage(), tableInit,
+      getModuleSpecificName(module, GlobalNameStringData));
+  table->setAlignment(tableAlign);
+
+  auto int32Ty = Type::getInt32Ty(context);
+  for (auto [var, entry] : zip(strings, layout)) {
+    auto [field, size, key] = entry;
+    auto pointer = ConstantExpr::getInBoundsGetElementPtr(
+        tableInit->getType(), table,
+        ArrayRef<Constant *>{ConstantInt::get(int32Ty, 0),
+                             ConstantInt::get(int32Ty, field)});
+
+    var->replaceAllUsesWith(pointer);
+    var->eraseFromParent();
+    records.emplace_back(pointer, size, key);
+  }
+
+  return tableSize;
+}
+
 std::vector<ObfuscatedStringRecord>
-StringObfuscatorPass::obfuscateStrings(Module &module) {
+StringObfuscatorPass::obfuscateStrings(Module &module,
+                                       FunctionSelection const &selection,
+                                       uint64_t &tableSize) {
+  // Without any patterns (or functions opting out), every string is fair
+  // game, including ones which aren't used by any function at all.
+  auto &config = Config::get()->stringObfuscator;
+  bool isSelective =
+      !config.matchers.empty() || selection.hasOptOuts(config);
+
+  SmallVector<GlobalValue *> usedGlobalsList;
+  collectUsedGlobalVariables(module, usedGlobalsList, /*CompilerUsed=*/false);
+  collectUsedGlobalVariables(module, usedGlobalsList, /*CompilerUsed=*/true);
+  SmallPtrSet<GlobalValue *, 8> usedGlobals(usedGlobalsList.begin(),
+                                            usedGlobalsList.end());
+
   std::vector<ObfuscatedStringRecord> modifiedGlobals;
-  for (auto &var : module.globals()) {
+  SmallVector<GlobalVariable *> packedStrings;
+  DenseMap<Constant *, GlobalVariable *> uniqueStrings;
+  for (auto &var : make_early_inc_range(module.globals())) {
     // Can't operate on uninitialized or imported globals.
     if (!var.hasInitializer() || var.hasExternalLinkage())
       continue;
@@ -54,7 +296,41 @@ StringObfuscatorPass::obfuscateStrings(Module &module) {
     if (!data || !data->isString())
       continue;
 
+    // Decrypting a string costs startup time and moves it to writable memory,
+    // so only strings which a selected function might read are obfuscated.
+    SmallPtrSet<Value *, 8> visited;
+    if (isSelective && !isUsedBySelectedFunction(&var, selection, visited)) {
+      ++NumStringsSkipped;
+      continue;
+    }
+
+    ++NumStringsObfuscated;
+    if (canPackString(var, usedGlobals)) {
+      // Once a string is made writable, the linker can no longer merge it with
+      // identical ones, so that needs to happen here instead. Constants are
+      // uniqued, so identical strings share the same initializer.
+      if (var.hasAtLeastLocalUnnamedAddr()) {
+        auto [it, inserted] = uniqueStrings.try_emplace(initializer, &var);
+        if (!inserted) {
+          // Users of the duplicate may rely on its alignment.
+          auto survivor = it->second;
+          if (var.getAlign() && (!survivor->getAlign() ||
+                                 *var.getAlign() > *survivor->getAlign()))
+            survivor->setAlignment(var.getAlign());
+
+          var.replaceAllUsesWith(survivor);
+          var.eraseFromParent();
+          ++NumStringsDeduplicated;
+          continue;
+        }
+      }
+
+      packedStrings.emplace_back(&var);
+      continue;
+    }
+
     auto content = data->getAsString();
+    RandomStreamScope randomScope("string-obfuscator", var.getName());
     uint8_t xorKey = getRandomInt8();
 
     var.setInitializer(
@@ -66,14 +342,24 @@ StringObfuscatorPass::obfuscateStrings(Module &module) {
     modifiedGlobals.emplace_back(&var, content.size() - 1, xorKey);
   }
 
+  tableSize = packStrings(module, packedStrings, modifiedGlobals);
   return modifiedGlobals;
 }
 
-Function *StringObfuscatorPass::getDeobfuscateFunction(Module &module) {
-  SMDiagnostic unusedError;
+Function *StringObfuscatorPass::getRuntimeFunction(LLVMContext &context) {
+  // The parsed runtime module is owned by the context it was parsed into and
+  // is freed along with it; the handle is nulled out when that happens, so a
+  // new context allocated at the same address will not see a stale entry.
+  static std::mutex cacheMutex;
+  static std::map<LLVMContext const *, WeakVH> cache;
+
+  std::lock_guard lock(cacheMutex);
+  auto &cachedFn = cache[&context];
+  if (cachedFn)
+    return cast<Function>(cachedFn);
 
-  auto runtimeModule =
-      parseIR(getDeobfuscateBitcode(), unusedError, module.getContext());
+  SMDiagnostic unusedError;
+  auto runtimeModule = parseIR(getDeobfuscateBitcode(), unusedError, context);
   assert(runtimeModule && "Failed to parse string obfuscator runtime IR!");
 
   // TODO: Ideally the name of the runtime function doesn't live here as a
@@ -81,9 +367,135 @@ Function *StringObfuscatorPass::getDeobfuscateFunction(Module &module) {
   auto deobfuscateFn = runtimeModule->getFunction("deobfuscateXOR");
   assert(deobfuscateFn && "String deobfuscation function missing in runtime!");
 
-  return localizeFunction(
-      module, *deobfuscateFn,
-      getModuleSpecificName(module, FunctionNameDeobfuscate));
+  // The runtime is built for a generic CPU of the configured target; the
+  // localized copy should be code generated for whatever CPU the module it is
+  // localized into is built for instead. Target features are left alone, as
+  // the vectorized kernels depend on them.
+  for (auto &func : *runtimeModule) {
+    func.removeFnAttr("target-cpu");
+    func.removeFnAttr("tune-cpu");
+  }
+
+  // Module flags, identification, etc. only get in the way of linking the
+  // runtime into other modules (which may have been built differently).
+  SmallVector<NamedMDNode *> namedMetadata;
+  for (auto &node : runtimeModule->named_metadata())
+    namedMetadata.emplace_back(&node);
+  for (auto node : namedMetadata)
+    runtimeModule->eraseNamedMetadata(node);
+
+  runtimeModule.release();
+  cachedFn = deobfuscateFn;
+  return deobfuscateFn;
+}
+
+Function *StringObfuscatorPass::getDeobfuscateFunction(Module &module) {
+  auto name = getModuleSpecificName(module, FunctionNameDeobfuscate);
+  auto existingFn = module.getFunction(name);
+  if (existingFn && !existingFn->empty())
+    return existingFn;
+
+  // The runtime is made up of several kernels (plus a dispatcher), so the
+  // whole runtime module needs to be copied in. Everything but the entry point
+  // is made local up front, which also makes the linker only bring in what
+  // the entry point needs and take care of any clashing names.
+  auto linkage = Config::get()->getDefaultLinkage();
+  auto runtimeFn = getRuntimeFunction(module.getContext());
+  auto runtimeFnName = runtimeFn->getName();
+  auto runtimeModule = CloneModule(*runtimeFn->getParent());
+
+  // The vectorized kernels (and the CPU feature checks picking one of them)
+  // can only be code generated for the architecture the runtime was built for;
+  // other targets get the portable kernel, without any of the features of the
+  // runtime's target.
+  auto runtimeArch = Triple(runtimeModule->getTargetTriple()).getArch();
+  if (Triple(module.getTargetTriple()).getArch() != runtimeArch) {
+    runtimeFnName = FunctionNameRuntimePortable;
+    for (auto &func : *runtimeModule)
+      func.removeFnAttr("target-features");
+  }
+
+  runtimeModule->setDataLayout(module.getDataLayout());
+  runtimeModule->setTargetTriple(module.getTargetTriple());
+  for (auto &global : runtimeModule->global_values()) {
+    if (!global.isDeclaration())
+      global.setLinkage(linkage);
+  }
+
+  auto entryFn = runtimeModule->getFunction(runtimeFnName);
+  entryFn->setName(name);
+  entryFn->setLinkage(GlobalValue::ExternalLinkage);
+
+  [[maybe_unused]] bool failed =
+      Linker::linkModules(module, std::move(runtimeModule));
+  assert(!failed && "Failed to link string obfuscator runtime!");
+
+  auto deobfuscateFn = module.getFunction(name);
+  deobfuscateFn->setLinkage(linkage);
+  return deobfuscateFn;
+}
+
+/// Emit a loop deobfuscating all of \p records at the insertion point of
+/// \p builder, leaving the builder positioned after the loop.
+///
+/// Rather than a call per string, the strings are described by a constant
+/// table of (pointer, size, key) entries which the loop walks; the code emitted
+/// is the same size no matter how many strings there are.
+static void createDeobfuscateLoop(IRBuilder<> &builder, Module &module,
+                                  Function *deobfuscateFn,
+                                  ArrayRef<ObfuscatedStringRecord> records) {
+  if (records.empty())
+    return;
+
+  auto &context = module.getContext();
+  auto entryType =
+      StructType::get(PointerType::getUnqual(context), builder.getInt64Ty(),
+                      builder.getInt8Ty());
+
+  SmallVector<Constant *> entries;
+  entries.reserve(records.size());
+  for (auto const &string : records) {
+    entries.emplace_back(ConstantStruct::get(
+        entryType, {/*pointer=*/string.handle,
+                    /*size=*/builder.getInt64(string.size),
+                    /*key=*/builder.getInt8(string.key)}));
+  }
+
+  auto tableType = ArrayType::get(entryType, entries.size());
+  auto table = new GlobalVariable(
+      module, tableType, /*isConstant=*/true,
+      Config::get()->getDefaultLinkage(),
+      ConstantArray::get(tableType, entries),
+      getModuleSpecificName(module, GlobalNameStringTable));
+
+  auto func = builder.GetInsertBlock()->getParent();
+  auto headerBlock = builder.GetInsertBlock();
+  auto loopBlock = BasicBlock::Create(context, "loop", func);
+  auto exitBlock = BasicBlock::Create(context, "exit", func);
+  builder.CreateBr(loopBlock);
+
+  builder.SetInsertPoint(loopBlock);
+  auto index = builder.CreatePHI(builder.getInt64Ty(), 2);
+  index->addIncoming(builder.getInt64(0), headerBlock);
+
+  auto entryPtr = builder.CreateInBoundsGEP(tableType, table,
+                                            {builder.getInt64(0), index});
+  auto loadField = [&](unsigned field) {
+    auto type = entryType->getElementType(field);
+    auto fieldPtr = builder.CreateStructGEP(entryType, entryPtr, field);
+    return builder.CreateLoad(type, fieldPtr);
+  };
+  builder.CreateCall(deobfuscateFn, {/*pointer=*/loadField(0),
+                                     /*size=*/loadField(1),
+                                     /*key=*/loadField(2)});
+
+  auto nextIndex = builder.CreateAdd(index, builder.getInt64(1));
+  index->addIncoming(nextIndex, loopBlock);
+  builder.CreateCondBr(
+      builder.CreateICmpULT(nextIndex, builder.getInt64(entries.size())),
+      loopBlock, exitBlock);
+
+  builder.SetInsertPoint(exitBlock);
 }
 
 Function *StringObfuscatorPass::createDeobfuscateAllFunction(
@@ -97,15 +509,9 @@ Function *StringObfuscatorPass::createDeobfuscateAllFunction(
 
   auto deobfuscateFn = getDeobfuscateFunction(module);
 
-  // Build a huge block with a call to the deobfuscate function for every
-  // single obfuscated string in the binary.
   auto body = BasicBlock::Create(context, "", result);
   IRBuilder<> builder(body);
-  for (auto string : records) {
-    builder.CreateCall(deobfuscateFn, {/*pointer=*/string.handle,
-                                       /*size=*/builder.getInt64(string.size),
-                                       /*key=*/builder.getInt8(string.key)});
-  }
+  createDeobfuscateLoop(builder, module, deobfuscateFn, records);
   builder.CreateRetVoid();
 
   // TODO: This used to be done to prevent the optimizer from deleting these
@@ -118,12 +524,174 @@ Function *StringObfuscatorPass::createDeobfuscateAllFunction(
   return result;
 }
 
-PreservedAnalyses StringObfuscatorPass::run(Module &module,
-                                            ModuleAnalysisManager &) {
-  auto obfuscatedStrings = obfuscateStrings(module);
-  auto deobfuscateAllFn =
-      createDeobfuscateAllFunction(module, obfuscatedStrings);
+/// Collect the uses of \p value by instructions, either direct or through
+/// constant expressions, into \p uses.
+///
+/// Returns false if \p value is used by anything other than an instruction or
+/// constant expression, e.g. the initializer of another global.
+static bool collectInstructionUses(Value *value, SmallVectorImpl<Use *> &uses) {
+  for (auto &use : value->uses()) {
+    auto user = use.getUser();
+    if (isa<Instruction>(user)) {
+      uses.emplace_back(&use);
+      continue;
+    }
+
+    if (!isa<ConstantExpr>(user) || !collectInstructionUses(user, uses))
+      return false;
+  }
+
+  return true;
+}
+
+void StringObfuscatorPass::createLazyGroup(
+    Module &module, ArrayRef<ObfuscatedStringRecord> records,
+    ArrayRef<Use *> uses) {
+  auto &context = module.getContext();
+  auto linkage = Config::get()->getDefaultLinkage();
+  auto int8Ty = Type::getInt8Ty(context);
+  auto fnType = FunctionType::get(Type::getVoidTy(context), false);
+
+  auto flag = new GlobalVariable(
+      module, int8Ty, /*isConstant=*/false, linkage,
+      ConstantInt::get(int8Ty, LazyStateEncrypted),
+      getModuleSpecificName(module, GlobalNameLazyOnceFlag));
+
+  // The slow path claims the flag, decrypts the group's strings, then
+  // publishes them; any other thread arriving in the meantime waits for the
+  // strings to be published.
+  auto initFn =
+      Function::Create(fnType, linkage,
+                       getModuleSpecificName(module, FunctionNameLazyInit),
+                       module);
+  initFn->addFnAttr(Attribute::NoInline);
+  initFn->addFnAttr(Attribute::Cold);
+  {
+    auto entryBlock = BasicBlock::Create(context, "entry", initFn);
+    auto decryptBlock = BasicBlock::Create(context, "decrypt", initFn);
+    auto waitBlock = BasicBlock::Create(context, "wait", initFn);
+    auto doneBlock = BasicBlock::Create(context, "done", initFn);
 
+    IRBuilder<> builder(entryBlock);
+    auto exchange = builder.CreateAtomicCmpXchg(
+        flag, builder.getInt8(LazyStateEncrypted),
+        builder.getInt8(LazyStateDecrypting), MaybeAlign(1),
+        AtomicOrdering::Acquire, AtomicOrdering::Acquire);
+    builder.CreateCondBr(builder.CreateExtractValue(exchange, 1), decryptBlock,
+                         waitBlock);
+
+    builder.SetInsertPoint(decryptBlock);
+    createDeobfuscateLoop(builder, module, getDeobfuscateFunction(module),
+                          records);
+    builder
+        .CreateAlignedStore(builder.getInt8(LazyStateDecrypted), flag,
+                            MaybeAlign(1))
+        ->setAtomic(AtomicOrdering::Release);
+    builder.CreateRetVoid();
+
+    builder.SetInsertPoint(waitBlock);
+    auto state = builder.CreateAlignedLoad(int8Ty, flag, MaybeAlign(1));
+    state->setAtomic(AtomicOrdering::Acquire);
+    builder.CreateCondBr(
+        builder.CreateICmpEQ(state, builder.getInt8(LazyStateDecrypted)),
+        doneBlock, waitBlock);
+
+    builder.SetInsertPoint(doneBlock);
+    builder.CreateRetVoid();
+  }
+
+  // The fast path is inlined into every use site; once the strings have been
+  // decrypted, it is a single acquire load and a (likely) branch.
+  auto accessFn =
+      Function::Create(fnType, linkage,
+                       getModuleSpecificName(module, FunctionNameLazyAccess),
+                       module);
+  accessFn->addFnAttr(Attribute::AlwaysInline);
+  {
+    auto entryBlock = BasicBlock::Create(context, "entry", accessFn);
+    auto initBlock = BasicBlock::Create(context, "init", accessFn);
+    auto readyBlock = BasicBlock::Create(context, "ready", accessFn);
+
+    IRBuilder<> builder(entryBlock);
+    auto state = builder.CreateAlignedLoad(int8Ty, flag, MaybeAlign(1));
+    state->setAtomic(AtomicOrdering::Acquire);
+    builder.CreateCondBr(
+        builder.CreateICmpEQ(state, builder.getInt8(LazyStateDecrypted)),
+        readyBlock, initBlock,
+        MDBuilder(context).createBranchWeights(/*TrueWeight=*/2000,
+                                               /*FalseWeight=*/1));
+
+    builder.SetInsertPoint(initBlock);
+    builder.CreateCall(initFn);
+    builder.CreateBr(readyBlock);
+
+    builder.SetInsertPoint(readyBlock);
+    builder.CreateRetVoid();
+  }
+
+  // Values flowing into PHI nodes need to be ready by the end of the incoming
+  // block, since nothing can be inserted before a PHI node itself.
+  SmallPtrSet<Instruction *, 16> guardedInsts;
+  for (auto use : uses) {
+    auto insertionPoint = cast<Instruction>(use->getUser());
+    if (auto phi = dyn_cast<PHINode>(insertionPoint))
+      insertionPoint = phi->getIncomingBlock(*use)->getTerminator();
+
+    if (!guardedInsts.insert(insertionPoint).second)
+      continue;
+
+    IRBuilder<> builder(insertionPoint);
+    builder.CreateCall(accessFn);
+  }
+}
+
+std::vector<ObfuscatedStringRecord> StringObfuscatorPass::insertLazyAccessors(
+    Module &module, std::vector<ObfuscatedStringRecord> const &records) {
+  auto groupSize =
+      static_cast<size_t>(Config::get()->stringObfuscator.lazyGroupSize);
+
+  std::vector<ObfuscatedStringRecord> eagerRecords;
+  std::vector<ObfuscatedStringRecord> group;
+  SmallVector<Use *> groupUses;
+  size_t groupBytes = 0;
+
+  auto finishGroup = [&] {
+    if (!group.empty())
+      createLazyGroup(module, group, groupUses);
+
+    group.clear();
+    groupUses.clear();
+    groupBytes = 0;
+  };
+
+  // Strings are grouped in module order, which tends to keep strings that are
+  // close together in memory in the same group.
+  for (auto const &record : records) {
+    SmallVector<Use *> uses;
+    if (!collectInstructionUses(record.handle, uses)) {
+      eagerRecords.emplace_back(record);
+      continue;
+    }
+
+    // Nothing will ever read a string without uses; there is no need to ever
+    // decrypt it.
+    if (uses.empty())
+      continue;
+
+    if (!group.empty() && groupBytes + record.size > groupSize)
+      finishGroup();
+
+    group.emplace_back(record);
+    groupUses.append(uses);
+    groupBytes += record.size;
+  }
+  finishGroup();
+
+  return eagerRecords;
+}
+
+void StringObfuscatorPass::insertDeobfuscateAllCall(
+    Module &module, Function *deobfuscateAllFn) {
   if (auto mainFn = module.getFunction("main")) {
     auto &entryBlock = mainFn->getEntryBlock();
     auto callBlock = BasicBlock::Create(mainFn->getContext(), "",
@@ -142,6 +710,40 @@ PreservedAnalyses StringObfuscatorPass::run(Module &module,
     // strings which have yet to be deobfuscated.
     appendToGlobalCtors(module, deobfuscateAllFn, /*priority=*/0);
   }
+}
+
+PreservedAnalyses StringObfuscatorPass::run(Module &module,
+                                            ModuleAnalysisManager &mam) {
+  auto &selection = mam.getResult<FunctionSelectionAnalysis>(module);
+  auto &fam =
+      mam.getResult<FunctionAnalysisManagerModuleProxy>(module).getManager();
+  uint64_t tableSize = 0;
+  auto obfuscatedStrings = obfuscateStrings(module, selection, tableSize);
+  emitStringRemarks(module, fam, obfuscatedStrings);
+
+  uint64_t numBytes = 0;
+  for (auto const &record : obfuscatedStrings)
+    numBytes += record.size;
+  auto tablePages = getStringTablePages(tableSize);
+  NumStringBytesEncrypted += numBytes;
+  NumStringTableBytes += tableSize;
+  NumStringTablePages += tablePages;
+  reportModuleCounters(DEBUG_TYPE, {{"strings", obfuscatedStrings.size()},
+                                    {"bytes", numBytes},
+                                    {"table-bytes", tableSize},
+                                    {"table-pages", tablePages}});
+
+  // Strings which can't be decrypted lazily are still decrypted up front; if
+  // there aren't any, the startup hook can be left out entirely.
+  if (Config::get()->stringObfuscator.isLazy) {
+    obfuscatedStrings = insertLazyAccessors(module, obfuscatedStrings);
+    if (obfuscatedStrings.empty())
+      return PreservedAnalyses::none();
+  }
+
+  auto deobfuscateAllFn =
+      createDeobfuscateAllFunction(module, obfuscatedStrings);
+  insertDeobfuscateAllCall(module, deobfuscateAllFn);
 
   return PreservedAnalyses::none();
 }
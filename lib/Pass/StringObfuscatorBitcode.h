@@ -1,261 +0,0 @@
-//===-- Pass/StringObfuscatorBitcode.h ------------------------------------===//
-//
-// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
-//
-// Use of this source code is governed by the BSD 3-Clause license; a full copy
-// of the license can be found in the LICENSE.txt file.
-//
-//===----------------------------------------------------------------------===//
-
-#ifndef LIMONCELLO_PASS_STRINGOBFUSCATORBITCODE_H
-#define LIMONCELLO_PASS_STRINGOBFUSCATORBITCODE_H
-
-#include <llvm/Support/MemoryBufferRef.h>
-
-// void (char *data, size_t size, uint8_t key) {
-//   for (size_t i = 0; i < size; ++i)
-//     data[i] ^= key;
-// }
-//
-// define void @(ptr noundef %0, i64 noundef %1, i8 noundef zeroext %2) {
-//   %4 = icmp eq i64 %1, 0
-//   br i1 %4, label %5, label %6
-//
-// 5:                                                ; preds = %6, %3
-//   ret void
-//
-// 6:                                                ; preds = %3, %6
-//   %7 = phi i64 [ %11, %6 ], [ 0, %3 ]
-//   %8 = getelementptr inbounds i8, ptr %0, i64 %7
-//   %9 = load i8, ptr %8, align 1
-//   %10 = xor i8 %9, %2
-//   store i8 %10, ptr %8, align 1
-//   %11 = add nuw i64 %7, 1
-//   %12 = icmp eq i64 %11, %1
-//   br i1 %12, label %5, label %6
-// }
-static unsigned char const deobfuscateBitcode[] = {
-    0xde, 0xc0, 0x17, 0x0b, 0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00,
-    0xf8, 0x09, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x42, 0x43, 0xc0, 0xde,
-    0x35, 0x14, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x62, 0x0c, 0x30, 0x24,
-    0x98, 0x96, 0xa6, 0xa5, 0xf7, 0xd7, 0x7f, 0x8d, 0xd3, 0xb7, 0x4f, 0xfb,
-    0xb6, 0xed, 0xd7, 0xb8, 0x5f, 0xff, 0xb4, 0x10, 0x05, 0xc8, 0x14, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x21, 0x0c, 0x00, 0x00, 0x34, 0x02, 0x00, 0x00,
-    0x0b, 0x02, 0x21, 0x00, 0x02, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x00,
-    0x07, 0x81, 0x23, 0x91, 0x41, 0xc8, 0x04, 0x49, 0x06, 0x10, 0x32, 0x39,
-    0x92, 0x01, 0x84, 0x0c, 0x25, 0x05, 0x08, 0x19, 0x1e, 0x04, 0x8b, 0x62,
-    0x80, 0x10, 0x45, 0x02, 0x42, 0x92, 0x0b, 0x42, 0x84, 0x10, 0x32, 0x14,
-    0x38, 0x08, 0x18, 0x4b, 0x0a, 0x32, 0x42, 0x88, 0x48, 0x70, 0xc4, 0x21,
-    0x23, 0x44, 0x12, 0x87, 0x8c, 0x10, 0x41, 0x92, 0x02, 0x64, 0xc8, 0x08,
-    0xb1, 0x14, 0x20, 0x43, 0x46, 0x88, 0x20, 0xc9, 0x01, 0x32, 0x42, 0x84,
-    0x18, 0x2a, 0x28, 0x2a, 0x90, 0x31, 0x7c, 0xb0, 0x5c, 0x91, 0x20, 0xc4,
-    0xc8, 0x00, 0x00, 0x00, 0x89, 0x20, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00,
-    0x32, 0x22, 0x08, 0x09, 0x20, 0x62, 0x46, 0x00, 0x21, 0x2b, 0x24, 0x98,
-    0x10, 0x21, 0x25, 0x24, 0x98, 0x10, 0x19, 0x27, 0x0c, 0x85, 0xa4, 0x90,
-    0x60, 0x42, 0x64, 0x5c, 0x20, 0x24, 0x64, 0x82, 0x60, 0x19, 0x01, 0x98,
-    0x23, 0x40, 0x28, 0xe6, 0x08, 0x40, 0xc1, 0x10, 0x20, 0x13, 0x44, 0x03,
-    0x01, 0x73, 0x04, 0x60, 0xa0, 0x02, 0x37, 0x47, 0x10, 0x4c, 0x01, 0x00,
-    0x51, 0x18, 0x00, 0x00, 0x74, 0x00, 0x00, 0x00, 0x1b, 0xe6, 0x24, 0xf8,
-    0xff, 0xff, 0xff, 0xff, 0x01, 0x68, 0x03, 0xc0, 0x0f, 0x00, 0x38, 0x00,
-    0xfe, 0x00, 0x90, 0x80, 0x09, 0xd0, 0x82, 0x30, 0x08, 0x08, 0x73, 0x90,
-    0x87, 0x70, 0x68, 0x87, 0x72, 0x68, 0x03, 0x78, 0x78, 0x87, 0x74, 0x70,
-    0x07, 0x7a, 0x28, 0x07, 0x79, 0x00, 0xdc, 0xe1, 0x1d, 0xdc, 0xa1, 0x0d,
-    0xd8, 0xa1, 0x1c, 0xc2, 0xc1, 0x1c, 0x00, 0xa2, 0x1d, 0xd2, 0xc1, 0x1d,
-    0xda, 0x80, 0x1d, 0xca, 0xe1, 0x1c, 0xc2, 0x81, 0x1d, 0xda, 0xc0, 0x1e,
-    0xca, 0x61, 0x1c, 0xe8, 0xe1, 0x1d, 0xe4, 0xa1, 0x0d, 0xee, 0x21, 0x1d,
-    0xc8, 0x81, 0x1e, 0xd0, 0x01, 0x80, 0x03, 0x80, 0x70, 0x87, 0x77, 0x68,
-    0x03, 0x7a, 0x90, 0x87, 0x70, 0x80, 0x07, 0x78, 0x48, 0x07, 0x77, 0x38,
-    0x87, 0x36, 0x68, 0x87, 0x70, 0xa0, 0x07, 0x74, 0x00, 0xe8, 0x41, 0x1e,
-    0xea, 0xa1, 0x1c, 0x00, 0x02, 0x1e, 0xe4, 0xe1, 0x1d, 0xc4, 0xa1, 0x1c,
-    0xda, 0x60, 0x1e, 0xe8, 0x21, 0x1c, 0xc6, 0x61, 0x1d, 0x80, 0x5f, 0xf8,
-    0x85, 0x71, 0x40, 0x87, 0x75, 0x98, 0x07, 0x7a, 0x58, 0x87, 0x5f, 0x20,
-    0x87, 0x70, 0x90, 0x87, 0x7b, 0x48, 0x07, 0x77, 0x00, 0x88, 0x79, 0xa0,
-    0x87, 0x70, 0x18, 0x87, 0x75, 0x68, 0x03, 0x78, 0x90, 0x87, 0x77, 0xa0,
-    0x87, 0x72, 0x18, 0x07, 0x7a, 0x78, 0x07, 0x79, 0x68, 0x03, 0x71, 0xa8,
-    0x07, 0x73, 0x30, 0x87, 0x72, 0x90, 0x87, 0x36, 0x98, 0x87, 0x74, 0xd0,
-    0x87, 0x72, 0x00, 0xf0, 0x00, 0x20, 0xe8, 0x21, 0x1c, 0xe4, 0xe1, 0x1c,
-    0xca, 0x81, 0x1e, 0xda, 0x60, 0x1c, 0xe0, 0xa1, 0x1e, 0x80, 0x70, 0x80,
-    0x07, 0x78, 0x60, 0x87, 0x72, 0x68, 0x83, 0x76, 0x88, 0x03, 0x80, 0xa0,
-    0x87, 0x70, 0x90, 0x87, 0x73, 0x28, 0x07, 0x7a, 0x68, 0x03, 0x73, 0x28,
-    0x87, 0x70, 0xa0, 0x87, 0x7a, 0x90, 0x87, 0x72, 0x98, 0x07, 0x60, 0x0d,
-    0xc2, 0xa1, 0x1c, 0xe6, 0x81, 0x0d, 0xd6, 0x60, 0x1c, 0xe4, 0x61, 0x1c,
-    0xd8, 0x60, 0x0d, 0xc6, 0x41, 0x1e, 0xf2, 0x01, 0x1e, 0xe8, 0xe1, 0x1d,
-    0xd8, 0x60, 0x0d, 0xc8, 0xe1, 0x1d, 0xe8, 0x01, 0x1e, 0xe4, 0xe1, 0x1d,
-    0xc8, 0x81, 0x0d, 0xd6, 0xc0, 0x1c, 0xe0, 0xa1, 0x0d, 0xc2, 0x41, 0x1e,
-    0xda, 0xc1, 0x1e, 0xf0, 0x80, 0x0d, 0xd6, 0xc0, 0x1c, 0xe0, 0x21, 0x0e,
-    0xec, 0xc0, 0x1c, 0xda, 0x81, 0x1d, 0xd8, 0x60, 0x0d, 0xcc, 0xa1, 0x1e,
-    0xd8, 0x81, 0x1d, 0xcc, 0x01, 0x1e, 0xe2, 0xc0, 0x0e, 0xd8, 0x60, 0x0d,
-    0xd8, 0x61, 0x1e, 0xca, 0x81, 0x0d, 0xd6, 0xc0, 0x1d, 0xca, 0xe1, 0x1d,
-    0xdc, 0x81, 0x0d, 0xd6, 0x40, 0x1e, 0xc2, 0x61, 0x1e, 0xd8, 0x60, 0x0d,
-    0xe4, 0x61, 0x1c, 0xe0, 0x61, 0x1c, 0xd8, 0x60, 0x0d, 0xe4, 0x81, 0x1c,
-    0xda, 0x81, 0x0d, 0xd6, 0x60, 0x1e, 0xd0, 0x21, 0x1c, 0xe4, 0x80, 0x0d,
-    0xd6, 0x60, 0x1e, 0xd0, 0x21, 0x1c, 0xe6, 0x80, 0x0d, 0xd6, 0x60, 0x1e,
-    0xda, 0x81, 0x0e, 0xd8, 0x60, 0x0d, 0xec, 0x01, 0x0f, 0xdc, 0xa0, 0x0e,
-    0xc2, 0x81, 0x0d, 0xd6, 0x40, 0x1f, 0xc6, 0xa1, 0x1d, 0xd8, 0x60, 0x0d,
-    0xf4, 0x61, 0x1c, 0xf4, 0x01, 0xd8, 0x60, 0x08, 0x01, 0xb0, 0x00, 0xa4,
-    0xb0, 0x81, 0x18, 0x04, 0x80, 0x14, 0x36, 0x18, 0xc4, 0x00, 0x90, 0x02,
-    0x20, 0x06, 0x00, 0x00, 0x49, 0x18, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
-    0x13, 0x88, 0x40, 0x18, 0x08, 0x00, 0x00, 0x00, 0x13, 0xb0, 0x70, 0x90,
-    0x87, 0x76, 0xb0, 0x03, 0x3a, 0x68, 0x83, 0x70, 0x80, 0x07, 0x78, 0x60,
-    0x87, 0x72, 0x68, 0x83, 0x76, 0x08, 0x87, 0x71, 0x78, 0x87, 0x79, 0xc0,
-    0x87, 0x38, 0x98, 0x03, 0x37, 0x80, 0x03, 0x37, 0x80, 0x83, 0x0d, 0x61,
-    0x50, 0x0e, 0x6d, 0xd0, 0x0e, 0x7a, 0xf0, 0x0e, 0x6d, 0x90, 0x0e, 0x76,
-    0x40, 0x07, 0x7a, 0x60, 0x07, 0x74, 0xd0, 0x06, 0xe9, 0x10, 0x07, 0x72,
-    0x80, 0x07, 0x7a, 0x10, 0x07, 0x72, 0x80, 0x07, 0x6d, 0xe0, 0x0e, 0x73,
-    0x20, 0x07, 0x7a, 0x60, 0x07, 0x74, 0xd0, 0x06, 0xb3, 0x10, 0x07, 0x72,
-    0x80, 0x07, 0x1a, 0x21, 0x4c, 0x0e, 0x3d, 0x72, 0x98, 0x1e, 0x7e, 0x4d,
-    0xe9, 0xf2, 0xb4, 0xfb, 0xfc, 0x14, 0x9b, 0xeb, 0xf3, 0x71, 0x98, 0xfe,
-    0x96, 0x4b, 0xeb, 0x6e, 0x7a, 0xba, 0x5d, 0x76, 0x8d, 0x87, 0x54, 0x80,
-    0x43, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x38, 0x80, 0xc4, 0x06, 0x81, 0xa2, 0x3b, 0x02, 0x00, 0x00, 0x59,
-    0x20, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x32, 0x1e, 0x98, 0x10,
-    0x19, 0x11, 0x4c, 0x90, 0x8c, 0x09, 0x26, 0x47, 0xc6, 0x04, 0x43, 0xba,
-    0x22, 0x20, 0x1c, 0x4b, 0x68, 0x06, 0xba, 0x12, 0x28, 0x84, 0x82, 0x18,
-    0x01, 0x28, 0x07, 0x9a, 0x11, 0x00, 0x00, 0x00, 0xb1, 0x18, 0x00, 0x00,
-    0x97, 0x00, 0x00, 0x00, 0x33, 0x08, 0x80, 0x1c, 0xc4, 0xe1, 0x1c, 0x66,
-    0x14, 0x01, 0x3d, 0x88, 0x43, 0x38, 0x84, 0xc3, 0x8c, 0x42, 0x80, 0x07,
-    0x79, 0x78, 0x07, 0x73, 0x98, 0x71, 0x0c, 0xe6, 0x00, 0x0f, 0xed, 0x10,
-    0x0e, 0xf4, 0x80, 0x0e, 0x33, 0x0c, 0x42, 0x1e, 0xc2, 0xc1, 0x1d, 0xce,
-    0xa1, 0x1c, 0x66, 0x30, 0x05, 0x3d, 0x88, 0x43, 0x38, 0x84, 0x83, 0x1b,
-    0xcc, 0x03, 0x3d, 0xc8, 0x43, 0x3d, 0x8c, 0x03, 0x3d, 0xcc, 0x78, 0x8c,
-    0x74, 0x70, 0x07, 0x7b, 0x08, 0x07, 0x79, 0x48, 0x87, 0x70, 0x70, 0x07,
-    0x7a, 0x70, 0x03, 0x76, 0x78, 0x87, 0x70, 0x20, 0x87, 0x19, 0xcc, 0x11,
-    0x0e, 0xec, 0x90, 0x0e, 0xe1, 0x30, 0x0f, 0x6e, 0x30, 0x0f, 0xe3, 0xf0,
-    0x0e, 0xf0, 0x50, 0x0e, 0x33, 0x10, 0xc4, 0x1d, 0xde, 0x21, 0x1c, 0xd8,
-    0x21, 0x1d, 0xc2, 0x61, 0x1e, 0x66, 0x30, 0x89, 0x3b, 0xbc, 0x83, 0x3b,
-    0xd0, 0x43, 0x39, 0xb4, 0x03, 0x3c, 0xbc, 0x83, 0x3c, 0x84, 0x03, 0x3b,
-    0xcc, 0xf0, 0x14, 0x76, 0x60, 0x07, 0x7b, 0x68, 0x07, 0x37, 0x68, 0x87,
-    0x72, 0x68, 0x07, 0x37, 0x80, 0x87, 0x70, 0x90, 0x87, 0x70, 0x60, 0x07,
-    0x76, 0x28, 0x07, 0x76, 0xf8, 0x05, 0x76, 0x78, 0x87, 0x77, 0x80, 0x87,
-    0x5f, 0x08, 0x87, 0x71, 0x18, 0x87, 0x72, 0x98, 0x87, 0x79, 0x98, 0x81,
-    0x2c, 0xee, 0xf0, 0x0e, 0xee, 0xe0, 0x0e, 0xf5, 0xc0, 0x0e, 0xec, 0x30,
-    0x03, 0x62, 0xc8, 0xa1, 0x1c, 0xe4, 0xa1, 0x1c, 0xcc, 0xa1, 0x1c, 0xe4,
-    0xa1, 0x1c, 0xdc, 0x61, 0x1c, 0xca, 0x21, 0x1c, 0xc4, 0x81, 0x1d, 0xca,
-    0x61, 0x06, 0xd6, 0x90, 0x43, 0x39, 0xc8, 0x43, 0x39, 0x98, 0x43, 0x39,
-    0xc8, 0x43, 0x39, 0xb8, 0xc3, 0x38, 0x94, 0x43, 0x38, 0x88, 0x03, 0x3b,
-    0x94, 0xc3, 0x2f, 0xbc, 0x83, 0x3c, 0xfc, 0x82, 0x3b, 0xd4, 0x03, 0x3b,
-    0xb0, 0xc3, 0x0c, 0xc7, 0x69, 0x87, 0x70, 0x58, 0x87, 0x72, 0x70, 0x83,
-    0x74, 0x68, 0x07, 0x78, 0x60, 0x87, 0x74, 0x18, 0x87, 0x74, 0xa0, 0x87,
-    0x19, 0xce, 0x53, 0x0f, 0xee, 0x00, 0x0f, 0xf2, 0x50, 0x0e, 0xe4, 0x90,
-    0x0e, 0xe3, 0x40, 0x0f, 0xe1, 0x20, 0x0e, 0xec, 0x50, 0x0e, 0x33, 0x20,
-    0x28, 0x1d, 0xdc, 0xc1, 0x1e, 0xc2, 0x41, 0x1e, 0xd2, 0x21, 0x1c, 0xdc,
-    0x81, 0x1e, 0xdc, 0xe0, 0x1c, 0xe4, 0xe1, 0x1d, 0xea, 0x01, 0x1e, 0x66,
-    0x18, 0x51, 0x38, 0xb0, 0x43, 0x3a, 0x9c, 0x83, 0x3b, 0xcc, 0x50, 0x24,
-    0x76, 0x60, 0x07, 0x7b, 0x68, 0x07, 0x37, 0x60, 0x87, 0x77, 0x78, 0x07,
-    0x78, 0x98, 0x51, 0x4c, 0xf4, 0x90, 0x0f, 0xf0, 0x50, 0x0e, 0x33, 0x1e,
-    0x6a, 0x1e, 0xca, 0x61, 0x1c, 0xe8, 0x21, 0x1d, 0xde, 0xc1, 0x1d, 0x7e,
-    0x01, 0x1e, 0xe4, 0xa1, 0x1c, 0xcc, 0x21, 0x1d, 0xf0, 0x61, 0x06, 0x54,
-    0x85, 0x83, 0x38, 0xcc, 0xc3, 0x3b, 0xb0, 0x43, 0x3d, 0xd0, 0x43, 0x39,
-    0xfc, 0xc2, 0x3c, 0xe4, 0x43, 0x3b, 0x88, 0xc3, 0x3b, 0xb0, 0xc3, 0x8c,
-    0xc5, 0x0a, 0x87, 0x79, 0x98, 0x87, 0x77, 0x18, 0x87, 0x74, 0x08, 0x07,
-    0x7a, 0x28, 0x07, 0x72, 0x98, 0x81, 0x5c, 0xe3, 0x10, 0x0e, 0xec, 0xc0,
-    0x0e, 0xe5, 0x50, 0x0e, 0xf3, 0x30, 0x23, 0xc1, 0xd2, 0x41, 0x1e, 0xe4,
-    0xe1, 0x17, 0xd8, 0xe1, 0x1d, 0xde, 0x01, 0x1e, 0x66, 0x48, 0x19, 0x3b,
-    0xb0, 0x83, 0x3d, 0xb4, 0x83, 0x1b, 0x84, 0xc3, 0x38, 0x8c, 0x43, 0x39,
-    0xcc, 0xc3, 0x3c, 0xb8, 0xc1, 0x39, 0xc8, 0xc3, 0x3b, 0xd4, 0x03, 0x3c,
-    0xcc, 0x48, 0xb4, 0x71, 0x08, 0x07, 0x76, 0x60, 0x07, 0x71, 0x08, 0x87,
-    0x71, 0x58, 0x87, 0x19, 0xdb, 0xc6, 0x0e, 0xec, 0x60, 0x0f, 0xed, 0xe0,
-    0x06, 0xf0, 0x20, 0x0f, 0xe5, 0x30, 0x0f, 0xe5, 0x20, 0x0f, 0xf6, 0x50,
-    0x0e, 0x6e, 0x10, 0x0e, 0xe3, 0x30, 0x0e, 0xe5, 0x30, 0x0f, 0xf3, 0xe0,
-    0x06, 0xe9, 0xe0, 0x0e, 0xe4, 0x50, 0x0e, 0xf8, 0x30, 0x23, 0xe2, 0xec,
-    0x61, 0x1c, 0xc2, 0x81, 0x1d, 0xd8, 0xe1, 0x17, 0xec, 0x21, 0x1d, 0xe6,
-    0x21, 0x1d, 0xc4, 0x21, 0x1d, 0xd8, 0x21, 0x1d, 0xe8, 0x21, 0x1f, 0x66,
-    0x20, 0x9d, 0x3b, 0xbc, 0x43, 0x3d, 0xb8, 0x03, 0x39, 0x94, 0x83, 0x39,
-    0xcc, 0x58, 0xbc, 0x70, 0x70, 0x07, 0x77, 0x78, 0x07, 0x7a, 0x08, 0x07,
-    0x7a, 0x48, 0x87, 0x77, 0x70, 0x07, 0x00, 0x00, 0x79, 0x20, 0x00, 0x00,
-    0x59, 0x00, 0x00, 0x00, 0x72, 0x1e, 0x48, 0x20, 0x43, 0x88, 0x0c, 0x19,
-    0x09, 0x72, 0x32, 0x48, 0x20, 0x23, 0x81, 0x8c, 0x91, 0x91, 0xd1, 0x44,
-    0xa0, 0x10, 0x28, 0x64, 0x3c, 0x31, 0x32, 0x42, 0x8e, 0x90, 0x21, 0xa3,
-    0xa8, 0x30, 0xaf, 0x01, 0x8b, 0x92, 0x4d, 0x57, 0x97, 0x1c, 0x4d, 0x1c,
-    0x00, 0x00, 0x00, 0x00, 0x53, 0x44, 0x4b, 0x20, 0x56, 0x65, 0x72, 0x73,
-    0x69, 0x6f, 0x6e, 0x77, 0x63, 0x68, 0x61, 0x72, 0x5f, 0x73, 0x69, 0x7a,
-    0x65, 0x62, 0x72, 0x61, 0x6e, 0x63, 0x68, 0x2d, 0x74, 0x61, 0x72, 0x67,
-    0x65, 0x74, 0x2d, 0x65, 0x6e, 0x66, 0x6f, 0x72, 0x63, 0x65, 0x6d, 0x65,
-    0x6e, 0x74, 0x73, 0x69, 0x67, 0x6e, 0x2d, 0x72, 0x65, 0x74, 0x75, 0x72,
-    0x6e, 0x2d, 0x61, 0x64, 0x64, 0x72, 0x65, 0x73, 0x73, 0x73, 0x69, 0x67,
-    0x6e, 0x2d, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x2d, 0x61, 0x64, 0x64,
-    0x72, 0x65, 0x73, 0x73, 0x2d, 0x61, 0x6c, 0x6c, 0x73, 0x69, 0x67, 0x6e,
-    0x2d, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x2d, 0x61, 0x64, 0x64, 0x72,
-    0x65, 0x73, 0x73, 0x2d, 0x77, 0x69, 0x74, 0x68, 0x2d, 0x62, 0x6b, 0x65,
-    0x79, 0x50, 0x49, 0x43, 0x20, 0x4c, 0x65, 0x76, 0x65, 0x6c, 0x75, 0x77,
-    0x74, 0x61, 0x62, 0x6c, 0x65, 0x66, 0x72, 0x61, 0x6d, 0x65, 0x2d, 0x70,
-    0x6f, 0x69, 0x6e, 0x74, 0x65, 0x72, 0x41, 0x70, 0x70, 0x6c, 0x65, 0x20,
-    0x63, 0x6c, 0x61, 0x6e, 0x67, 0x20, 0x76, 0x65, 0x72, 0x73, 0x69, 0x6f,
-    0x6e, 0x20, 0x31, 0x34, 0x2e, 0x30, 0x2e, 0x33, 0x20, 0x28, 0x63, 0x6c,
-    0x61, 0x6e, 0x67, 0x2d, 0x31, 0x34, 0x30, 0x33, 0x2e, 0x30, 0x2e, 0x32,
-    0x32, 0x2e, 0x31, 0x34, 0x2e, 0x31, 0x29, 0x00, 0x23, 0x08, 0x47, 0x30,
-    0x82, 0x80, 0x08, 0x23, 0x08, 0xc7, 0x30, 0x82, 0x70, 0x10, 0x23, 0x08,
-    0x47, 0x31, 0x82, 0x70, 0x18, 0x23, 0x08, 0xc7, 0x31, 0xc3, 0xb0, 0x04,
-    0xcc, 0x0c, 0x43, 0x23, 0x38, 0x33, 0x0c, 0xcf, 0x00, 0xcd, 0x30, 0x3c,
-    0x04, 0x34, 0xc3, 0xf0, 0x14, 0xd0, 0x0c, 0xc3, 0x63, 0x40, 0x33, 0x0c,
-    0xd1, 0xb1, 0xcc, 0x30, 0x44, 0x48, 0x33, 0xc3, 0x10, 0x25, 0xcd, 0x0c,
-    0x81, 0x22, 0x23, 0x81, 0x09, 0xca, 0x88, 0x8d, 0xcd, 0xae, 0xcd, 0xa5,
-    0xed, 0x8d, 0xac, 0x8e, 0xad, 0xcc, 0xc5, 0x8c, 0x2d, 0xec, 0x6c, 0x6e,
-    0x94, 0x24, 0x92, 0x26, 0xaa, 0xb2, 0x2e, 0x2c, 0x4b, 0x85, 0x8d, 0xcd,
-    0xae, 0xcd, 0x25, 0x8d, 0xac, 0xcc, 0x8d, 0x6e, 0x94, 0x40, 0x03, 0x00,
-    0xa9, 0x18, 0x00, 0x00, 0x25, 0x00, 0x00, 0x00, 0x0b, 0x0a, 0x72, 0x28,
-    0x87, 0x77, 0x80, 0x07, 0x7a, 0x58, 0x70, 0x98, 0x43, 0x3d, 0xb8, 0xc3,
-    0x38, 0xb0, 0x43, 0x39, 0xd0, 0xc3, 0x82, 0xe6, 0x1c, 0xc6, 0xa1, 0x0d,
-    0xe8, 0x41, 0x1e, 0xc2, 0xc1, 0x1d, 0xe6, 0x21, 0x1d, 0xe8, 0x21, 0x1d,
-    0xde, 0xc1, 0x1d, 0x16, 0x34, 0xe3, 0x60, 0x0e, 0xe7, 0x50, 0x0f, 0xe1,
-    0x20, 0x0f, 0xe4, 0x40, 0x0f, 0xe1, 0x20, 0x0f, 0xe7, 0x50, 0x0e, 0xf4,
-    0xb0, 0x80, 0x81, 0x07, 0x79, 0x28, 0x87, 0x70, 0x60, 0x07, 0x76, 0x78,
-    0x87, 0x71, 0x08, 0x07, 0x7a, 0x28, 0x07, 0x72, 0x58, 0x70, 0x9c, 0xc3,
-    0x38, 0xb4, 0x01, 0x3b, 0xa4, 0x83, 0x3d, 0x94, 0xc3, 0x02, 0x6b, 0x1c,
-    0xd8, 0x21, 0x1c, 0xdc, 0xe1, 0x1c, 0xdc, 0x20, 0x1c, 0xe4, 0x61, 0x1c,
-    0xdc, 0x20, 0x1c, 0xe8, 0x81, 0x1e, 0xc2, 0x61, 0x1c, 0xd0, 0xa1, 0x1c,
-    0xc8, 0x61, 0x1c, 0xc2, 0x81, 0x1d, 0xd8, 0x61, 0xc1, 0x01, 0x0f, 0xf4,
-    0x20, 0x0f, 0xe1, 0x50, 0x0f, 0xf4, 0x80, 0x0e, 0x00, 0x00, 0x00, 0x00,
-    0xd1, 0x10, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x07, 0xcc, 0x3c, 0xa4,
-    0x83, 0x3b, 0x9c, 0x03, 0x3b, 0x94, 0x03, 0x3d, 0xa0, 0x83, 0x3c, 0x94,
-    0x43, 0x38, 0x90, 0xc3, 0x01, 0x00, 0x00, 0x00, 0x61, 0x20, 0x00, 0x00,
-    0x35, 0x00, 0x00, 0x00, 0x13, 0x04, 0x43, 0x2c, 0x10, 0x00, 0x00, 0x00,
-    0x01, 0x00, 0x00, 0x00, 0x34, 0x25, 0x00, 0x00, 0xf1, 0x30, 0x00, 0x00,
-    0x19, 0x00, 0x00, 0x00, 0x22, 0x47, 0xc8, 0x90, 0x51, 0x0e, 0x84, 0x1e,
-    0x00, 0x00, 0x00, 0x00, 0x4f, 0x64, 0x01, 0x00, 0x6f, 0x6d, 0x6e, 0x69,
-    0x70, 0x6f, 0x74, 0x65, 0x6e, 0x74, 0x20, 0x63, 0x68, 0x61, 0x72, 0x53,
-    0x69, 0x6d, 0x70, 0x6c, 0x65, 0x20, 0x43, 0x2f, 0x43, 0x2b, 0x2b, 0x20,
-    0x54, 0x42, 0x41, 0x41, 0x6c, 0x6c, 0x76, 0x6d, 0x2e, 0x6c, 0x6f, 0x6f,
-    0x70, 0x2e, 0x6d, 0x75, 0x73, 0x74, 0x70, 0x72, 0x6f, 0x67, 0x72, 0x65,
-    0x73, 0x73, 0x00, 0x00, 0x13, 0x84, 0x01, 0x59, 0x21, 0x80, 0x01, 0x19,
-    0x6c, 0x08, 0xba, 0x0d, 0x03, 0x17, 0x06, 0xdf, 0x86, 0x41, 0x0c, 0xc4,
-    0xe0, 0xdb, 0x10, 0x78, 0x00, 0x00, 0x00, 0x00, 0xc3, 0x0d, 0x43, 0x01,
-    0x06, 0xb3, 0x0c, 0x81, 0x10, 0xe8, 0x40, 0xc5, 0x90, 0x08, 0x0c, 0xd0,
-    0x43, 0x30, 0x02, 0x0a, 0x22, 0x5c, 0x60, 0xf0, 0xb0, 0x01, 0x31, 0x04,
-    0x01, 0x80, 0x84, 0x01, 0x01, 0xc3, 0x0d, 0x41, 0x02, 0x06, 0xb3, 0x0c,
-    0x81, 0x10, 0x04, 0xc4, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00,
-    0x5b, 0x86, 0x22, 0x10, 0x83, 0x2d, 0xc3, 0x11, 0x88, 0xc1, 0x96, 0x41,
-    0x91, 0x3e, 0x00, 0x00, 0x21, 0x31, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
-    0x13, 0x86, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x71, 0x20, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x32, 0x0e, 0x10, 0x22,
-    0x84, 0x00, 0x84, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x65, 0x0c, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00, 0x12, 0x03, 0x94, 0xf0,
-    0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00,
-    0x06, 0x00, 0x00, 0x00, 0x4c, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
-    0x58, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x58, 0x00, 0x00, 0x00,
-    0x01, 0x00, 0x00, 0x00, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x14, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x2c, 0x00, 0x00, 0x00,
-    0x1e, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00,
-    0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00,
-    0xff, 0xff, 0xff, 0xff, 0x00, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x5d, 0x0c, 0x00, 0x00, 0x1a, 0x00, 0x00, 0x00, 0x12, 0x03, 0x94, 0xb9,
-    0x00, 0x00, 0x00, 0x00, 0x64, 0x65, 0x6f, 0x62, 0x66, 0x75, 0x73, 0x63,
-    0x61, 0x74, 0x65, 0x58, 0x4f, 0x52, 0x31, 0x34, 0x2e, 0x30, 0x2e, 0x33,
-    0x61, 0x72, 0x6d, 0x36, 0x34, 0x2d, 0x61, 0x70, 0x70, 0x6c, 0x65, 0x2d,
-    0x6d, 0x61, 0x63, 0x6f, 0x73, 0x78, 0x31, 0x33, 0x2e, 0x30, 0x2e, 0x30,
-    0x64, 0x61, 0x74, 0x61, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x4f,
-    0x62, 0x66, 0x75, 0x73, 0x63, 0x61, 0x74, 0x6f, 0x72, 0x52, 0x75, 0x6e,
-    0x74, 0x69, 0x6d, 0x65, 0x2e, 0x63, 0x5f, 0x64, 0x65, 0x6f, 0x62, 0x66,
-    0x75, 0x73, 0x63, 0x61, 0x74, 0x65, 0x58, 0x4f, 0x52, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-};
-
-inline llvm::MemoryBufferRef getDeobfuscateBitcode() {
-  return {{reinterpret_cast<char const *>(deobfuscateBitcode),
-           sizeof(deobfuscateBitcode)},
-          "deobfuscate"};
-}
-
-#endif
\ No newline at end of file
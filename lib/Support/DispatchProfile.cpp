@@ -0,0 +1,167 @@
+//===-- Support/DispatchProfile.cpp - Dispatch point profiling ------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Support/DispatchProfile.h"
+
+#include "Limoncello/Config/Config.h"
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+
+/// Get the key identifying \p func in profiles.
+static uint64_t getFunctionKey(Function const &func) {
+  auto sourceFile = func.getParent()->getSourceFileName();
+  return xxHash64((sourceFile + Twine('\0') + func.getName()).str());
+}
+
+void insertDispatchCounter(IRBuilder<> &builder, DispatchPointKind kind,
+                           unsigned index) {
+  auto func = builder.GetInsertBlock()->getParent();
+  auto &module = *func->getParent();
+  auto &ctx = module.getContext();
+
+  // Every point gets a counter of its own for now; since passes add points
+  // one function at a time, the table they end up in can only be laid out
+  // once all of them are known.
+  auto counter = new GlobalVariable(
+      module, builder.getInt64Ty(), /*isConstant=*/false,
+      Config::get()->getDefaultLinkage(), builder.getInt64(0),
+      "__lmcoDispatchCounter");
+  counter->setAlignment(Align(8));
+
+  // Counters are shared by all threads; relaxed increments are enough, as
+  // nothing is ordered with respect to them.
+  builder.CreateAtomicRMW(AtomicRMWInst::Add, counter, builder.getInt64(1),
+                          Align(8), AtomicOrdering::Monotonic);
+
+  auto int32Ty = Type::getInt32Ty(ctx);
+  auto int64Ty = Type::getInt64Ty(ctx);
+  auto points = module.getOrInsertNamedMetadata(DispatchPointsMetadataName);
+  points->addOperand(MDNode::get(
+      ctx, {ValueAsMetadata::get(counter),
+            ConstantAsMetadata::get(
+                ConstantInt::get(int32Ty, static_cast<uint32_t>(kind))),
+            ConstantAsMetadata::get(
+                ConstantInt::get(int64Ty, getFunctionKey(*func))),
+            ConstantAsMetadata::get(ConstantInt::get(int32Ty, index))}));
+}
+
+/// Read a value of type \p T (in host byte order) from \p data at \p offset,
+/// advancing past it.
+template <typename T> static T readValue(StringRef data, size_t &offset) {
+  T value;
+  std::memcpy(&value, data.data() + offset, sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+
+bool DispatchProfile::parse(StringRef data, unsigned hotPercentile) {
+  // Sizes of a chunk's header, of each entry of its points table, and of
+  // each point (its entry and its count) as a whole.
+  constexpr size_t HeaderSize = 16;
+  constexpr size_t EntrySize = 16;
+  constexpr size_t PointSize = EntrySize + 8;
+
+  DenseMap<PointKey, uint64_t> counts;
+  size_t offset = 0;
+  while (offset < data.size()) {
+    if (data.size() - offset < HeaderSize)
+      return false;
+
+    auto magic = readValue<uint64_t>(data, offset);
+    auto numPoints = readValue<uint64_t>(data, offset);
+    if (magic != DispatchProfileMagic ||
+        numPoints > (data.size() - offset) / PointSize)
+      return false;
+
+    auto countsOffset = offset + numPoints * EntrySize;
+    for (uint64_t i = 0; i < numPoints; ++i) {
+      auto function = readValue<uint64_t>(data, offset);
+      auto kind = readValue<uint32_t>(data, offset);
+      auto index = readValue<uint32_t>(data, offset);
+      auto count = readValue<uint64_t>(data, countsOffset);
+      counts[{kind, function, index}] += count;
+    }
+    offset = countsOffset;
+  }
+
+  // Like the profile summary, the hottest points are the ones at the top
+  // which together make up the given share of the total.
+  SmallVector<std::pair<uint64_t, PointKey>> sorted;
+  uint64_t total = 0;
+  for (auto [key, count] : counts) {
+    sorted.emplace_back(count, key);
+    total += count;
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](auto const &lhs, auto const &rhs) { return lhs > rhs; });
+
+  auto hotTotal = static_cast<double>(total) * hotPercentile / 100;
+  uint64_t cumulative = 0;
+  for (auto [count, key] : sorted) {
+    if (count == 0 || cumulative >= hotTotal)
+      break;
+
+    cumulative += count;
+    m_hotPoints.insert(key);
+    m_hotFunctions.insert({std::get<0>(key), std::get<1>(key)});
+  }
+
+  return true;
+}
+
+std::unique_ptr<DispatchProfile> DispatchProfile::load(StringRef path,
+                                                       unsigned hotPercentile) {
+  auto buffer = MemoryBuffer::getFile(path);
+  if (!buffer) {
+    errs() << "Limoncello: Failed to read dispatch profile " << path << ": "
+           << buffer.getError().message() << "\n";
+    return nullptr;
+  }
+
+  auto profile = std::make_unique<DispatchProfile>();
+  if (!profile->parse((*buffer)->getBuffer(), hotPercentile)) {
+    errs() << "Limoncello: Malformed dispatch profile " << path << "\n";
+    return nullptr;
+  }
+
+  return profile;
+}
+
+DispatchProfile const *DispatchProfile::get() {
+  static auto profile = [] {
+    auto const &config = Config::get()->dispatchProfile;
+    if (config.use.empty())
+      return std::unique_ptr<DispatchProfile>();
+
+    return load(config.use, config.hotPercentile);
+  }();
+
+  return profile.get();
+}
+
+bool DispatchProfile::isHotPoint(DispatchPointKind kind, Function const &func,
+                                 unsigned index) const {
+  return m_hotPoints.contains(
+      {static_cast<uint32_t>(kind), getFunctionKey(func), index});
+}
+
+bool DispatchProfile::hasHotPoints(DispatchPointKind kind,
+                                   Function const &func) const {
+  return m_hotFunctions.contains(
+      {static_cast<uint32_t>(kind), getFunctionKey(func)});
+}
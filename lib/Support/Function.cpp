@@ -12,6 +12,9 @@
 #include "Limoncello/Config/Config.h"
 #include "Limoncello/Support/Module.h"
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <llvm/Transforms/Utils/Local.h>
 #include <llvm/Transforms/Utils/ValueMapper.h>
@@ -59,42 +62,90 @@ Function *createStubFunction(Module &module, StringRef name, FunctionType *type,
 
 bool valueEscapesLocalBlock(Instruction &value) {
   for (auto const &use : value.uses()) {
-    auto inst = cast<Instruction>(&use);
-    if (inst->getParent() != inst->getParent() || isa<PHINode>(inst))
+    // A PHI node uses its incoming values at the end of the block they come
+    // from, rather than in its own block.
+    auto inst = cast<Instruction>(use.getUser());
+    auto block = inst->getParent();
+    if (auto phi = dyn_cast<PHINode>(inst))
+      block = phi->getIncomingBlock(use);
+
+    if (block != value.getParent())
       return true;
   }
 
   return false;
 }
 
-void repairSSA(Function &func) {
+/// Sort \p insts (all from \p func) into the order they appear in \p func.
+static void sortInFunctionOrder(Function &func,
+                                SmallVectorImpl<Instruction *> &insts) {
+  DenseMap<BasicBlock const *, unsigned> blockOrder;
+  unsigned index = 0;
+  for (auto &block : func)
+    blockOrder[&block] = index++;
+
+  llvm::sort(insts, [&](Instruction *lhs, Instruction *rhs) {
+    if (lhs->getParent() != rhs->getParent())
+      return blockOrder[lhs->getParent()] < blockOrder[rhs->getParent()];
+
+    return lhs->comesBefore(rhs);
+  });
+}
+
+unsigned repairSSA(Function &func) {
   auto entryBlock = &func.getEntryBlock();
 
+  // Every instruction needs to be checked once up front; after that, only the
+  // loads and stores created by demoting values (and the values being stored)
+  // can possibly need fixing.
+  SmallVector<Instruction *> candidates;
+  for (auto &inst : instructions(func))
+    candidates.emplace_back(&inst);
+
+  unsigned demotedCount = 0;
   std::vector<PHINode *> phis;
   std::vector<Instruction *> regs;
-  do {
+  while (!candidates.empty()) {
     phis.clear();
     regs.clear();
 
-    for (auto &block : func) {
-      for (auto &inst : block) {
-        if (isa<PHINode>(inst)) {
-          phis.emplace_back(cast<PHINode>(&inst));
-          continue;
-        }
-
-        bool canIgnore =
-            isa<AllocaInst>(&inst) && inst.getParent() == entryBlock;
-        bool needsFixing =
-            valueEscapesLocalBlock(inst) || inst.isUsedOutsideOfBlock(&block);
-        if (!canIgnore && needsFixing)
-          regs.emplace_back(&inst);
+    for (auto inst : candidates) {
+      if (auto phi = dyn_cast<PHINode>(inst)) {
+        phis.emplace_back(phi);
+        continue;
       }
+
+      bool canIgnore =
+          isa<AllocaInst>(inst) && inst->getParent() == entryBlock;
+      if (!canIgnore && valueEscapesLocalBlock(*inst))
+        regs.emplace_back(inst);
     }
 
+    SmallVector<AllocaInst *> slots;
     for (auto reg : regs)
-      DemoteRegToStack(*reg, entryBlock->getTerminator());
+      slots.emplace_back(DemoteRegToStack(*reg, entryBlock->getTerminator()));
     for (auto phi : phis)
-      DemotePHIToStack(phi, entryBlock->getTerminator());
-  } while (!regs.empty() || !phis.empty());
+      slots.emplace_back(DemotePHIToStack(phi, entryBlock->getTerminator()));
+
+    demotedCount += regs.size() + phis.size();
+
+    SmallPtrSet<Instruction *, 16> affected;
+    for (auto slot : slots) {
+      for (auto user : slot->users()) {
+        auto inst = cast<Instruction>(user);
+        affected.insert(inst);
+
+        if (auto store = dyn_cast<StoreInst>(inst))
+          if (auto value = dyn_cast<Instruction>(store->getValueOperand()))
+            affected.insert(value);
+      }
+    }
+
+    // Demotion order determines the order stack slots are created in, so the
+    // candidates need to be revisited in a stable order.
+    candidates.assign(affected.begin(), affected.end());
+    sortInFunctionOrder(func, candidates);
+  }
+
+  return demotedCount;
 }
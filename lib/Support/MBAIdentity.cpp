@@ -0,0 +1,204 @@
+//===-- Support/MBAIdentity.cpp - Mixed boolean-arithmetic identities -----===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Support/MBAIdentity.h"
+
+#include <llvm/IR/Constants.h>
+
+#include <algorithm>
+
+using namespace llvm;
+
+static constexpr auto Add = Instruction::Add;
+static constexpr auto Sub = Instruction::Sub;
+static constexpr auto Mul = Instruction::Mul;
+static constexpr auto And = Instruction::And;
+static constexpr auto Or = Instruction::Or;
+static constexpr auto Xor = Instruction::Xor;
+
+static constexpr auto X = MBAOperandX;
+static constexpr auto Y = MBAOperandY;
+static constexpr auto Zero = MBAOperandZero;
+static constexpr auto One = MBAOperandOne;
+static constexpr auto Two = MBAOperandTwo;
+static constexpr auto AllOnes = MBAOperandAllOnes;
+
+// All of the identities below hold in modular arithmetic, for any bit width
+// (including one); shifts are avoided for that reason, since shifting an `i1`
+// by one is poison. Negation is spelled `0 - y`, and complement `y ^ -1`.
+
+// x + y == (x & y) + (x | y)
+static constexpr MBANode AddAndOr[] = {{And, X, Y}, {Or, X, Y}, {Add, 0, 1}};
+
+// x + y == (x ^ y) + 2 * (x & y)
+static constexpr MBANode AddXorAnd[] = {
+    {Xor, X, Y}, {And, X, Y}, {Add, 1, 1}, {Add, 0, 2}};
+
+// x + y == 2 * (x | y) - (x ^ y)
+static constexpr MBANode AddOrXor[] = {
+    {Or, X, Y}, {Add, 0, 0}, {Xor, X, Y}, {Sub, 1, 2}};
+
+// x + y == x - ~y - 1
+static constexpr MBANode AddNot[] = {
+    {Xor, Y, AllOnes}, {Sub, X, 0}, {Sub, 1, One}};
+
+// x + y == (x | y) + (~x | y) - ~x
+static constexpr MBANode AddOrNotOr[] = {
+    {Or, X, Y}, {Xor, X, AllOnes}, {Or, 1, Y}, {Add, 0, 2}, {Sub, 3, 1}};
+
+// x - y == (x ^ -y) + 2 * (x & -y)
+static constexpr MBANode SubXorNegMul[] = {
+    {Sub, Zero, Y}, {Xor, X, 0}, {And, X, 0}, {Mul, Two, 2}, {Add, 1, 3}};
+
+// x - y == (x ^ y) - 2 * (~x & y)
+static constexpr MBANode SubXorMul[] = {{Xor, X, Y},
+                                        {Xor, X, AllOnes},
+                                        {And, 1, Y},
+                                        {Mul, Two, 2},
+                                        {Sub, 0, 3}};
+
+// x - y == (x ^ y) - ((~x & y) + (~x & y))
+static constexpr MBANode SubXorAdd[] = {
+    {Xor, X, Y}, {Xor, X, AllOnes}, {And, 1, Y}, {Add, 2, 2}, {Sub, 0, 3}};
+
+// x - y == (x & ~y) - (~x & y)
+static constexpr MBANode SubAndNot[] = {{Xor, Y, AllOnes},
+                                        {And, X, 0},
+                                        {Xor, X, AllOnes},
+                                        {And, 2, Y},
+                                        {Sub, 1, 3}};
+
+// x - y == x + ~y + 1
+static constexpr MBANode SubNot[] = {
+    {Xor, Y, AllOnes}, {Add, X, 0}, {Add, 1, One}};
+
+// x & y == (x + y) - (x | y)
+static constexpr MBANode AndAddOr[] = {{Add, X, Y}, {Or, X, Y}, {Sub, 0, 1}};
+
+// x & y == (~x | y) - ~x
+static constexpr MBANode AndNotOr[] = {
+    {Xor, X, AllOnes}, {Or, 0, Y}, {Sub, 1, 0}};
+
+// x & y == (x | y) - (x ^ y)
+static constexpr MBANode AndOrXor[] = {{Or, X, Y}, {Xor, X, Y}, {Sub, 0, 1}};
+
+// x & y == ~(~x | ~y)
+static constexpr MBANode AndNotNot[] = {
+    {Xor, X, AllOnes}, {Xor, Y, AllOnes}, {Or, 0, 1}, {Xor, 2, AllOnes}};
+
+// x | y == (x + y + 1) + (~x | ~y)
+static constexpr MBANode OrAddNotNot[] = {{Add, X, Y},       {Add, 0, One},
+                                          {Xor, X, AllOnes}, {Xor, Y, AllOnes},
+                                          {Or, 2, 3},        {Add, 1, 4}};
+
+// x | y == (x ^ y) + (x & y)
+static constexpr MBANode OrXorAnd[] = {{Xor, X, Y}, {And, X, Y}, {Add, 0, 1}};
+
+// x | y == (x & ~y) + y
+static constexpr MBANode OrAndNot[] = {
+    {Xor, Y, AllOnes}, {And, X, 0}, {Add, 1, Y}};
+
+// x | y == (x + y) - (x & y)
+static constexpr MBANode OrAddAnd[] = {{Add, X, Y}, {And, X, Y}, {Sub, 0, 1}};
+
+// x ^ y == (x | y) - (x & y)
+static constexpr MBANode XorOrAnd[] = {{Or, X, Y}, {And, X, Y}, {Sub, 0, 1}};
+
+// x ^ y == (x | y) & (~x | ~y)
+static constexpr MBANode XorOrNand[] = {{Or, X, Y},
+                                        {Xor, X, AllOnes},
+                                        {Xor, Y, AllOnes},
+                                        {Or, 1, 2},
+                                        {And, 0, 3}};
+
+// x ^ y == (x + y) - 2 * (x & y)
+static constexpr MBANode XorAddAnd[] = {
+    {Add, X, Y}, {And, X, Y}, {Add, 1, 1}, {Sub, 0, 2}};
+
+// x ^ y == (x & ~y) + (~x & y)
+static constexpr MBANode XorAndNot[] = {{Xor, Y, AllOnes},
+                                        {And, X, 0},
+                                        {Xor, X, AllOnes},
+                                        {And, 2, Y},
+                                        {Add, 1, 3}};
+
+// x ^ y == (x | y) - y + (~x & y)
+static constexpr MBANode XorOrSub[] = {
+    {Or, X, Y}, {Sub, 0, Y}, {Xor, X, AllOnes}, {And, 2, Y}, {Add, 1, 3}};
+
+/// Every identity, grouped by opcode.
+static constexpr MBAIdentity Identities[] = {
+    {Add, AddAndOr},     {Add, AddXorAnd}, {Add, AddOrXor},
+    {Add, AddNot},       {Add, AddOrNotOr},
+
+    {Sub, SubXorNegMul}, {Sub, SubXorMul}, {Sub, SubXorAdd},
+    {Sub, SubAndNot},    {Sub, SubNot},
+
+    {And, AndAddOr},     {And, AndNotOr},  {And, AndOrXor},
+    {And, AndNotNot},
+
+    {Or, OrAddNotNot},   {Or, OrXorAnd},   {Or, OrAndNot},
+    {Or, OrAddAnd},
+
+    {Xor, XorOrAnd},     {Xor, XorOrNand}, {Xor, XorAddAnd},
+    {Xor, XorAndNot},    {Xor, XorOrSub},
+};
+
+ArrayRef<MBAIdentity> getMBAIdentities(unsigned opcode) {
+  auto first = std::find_if(
+      std::begin(Identities), std::end(Identities),
+      [=](MBAIdentity const &identity) { return identity.opcode == opcode; });
+  auto last = std::find_if(
+      first, std::end(Identities),
+      [=](MBAIdentity const &identity) { return identity.opcode != opcode; });
+
+  return ArrayRef<MBAIdentity>(first, last);
+}
+
+unsigned getMaxMBAIdentitySize() {
+  size_t size = 0;
+  for (auto &identity : Identities)
+    size = std::max(size, identity.nodes.size());
+
+  return size;
+}
+
+Constant *getMBAConstant(int operand, Type *type) {
+  switch (operand) {
+  case MBAOperandZero:
+    return Constant::getNullValue(type);
+  case MBAOperandOne:
+    return ConstantInt::get(type, 1);
+  case MBAOperandTwo:
+    return ConstantInt::get(type, 2);
+  case MBAOperandAllOnes:
+    return Constant::getAllOnesValue(type);
+  default:
+    llvm_unreachable("Operand is not a constant");
+  }
+}
+
+InstructionCost getMBAIdentityCost(MBAIdentity const &identity, Type *type,
+                                   TargetTransformInfo const &tti) {
+  using OperandValueInfo = TargetTransformInfo::OperandValueInfo;
+  auto getOperandInfo = [=](int operand) -> OperandValueInfo {
+    if (operand >= 0 || operand == MBAOperandX || operand == MBAOperandY)
+      return {TargetTransformInfo::OK_AnyValue, TargetTransformInfo::OP_None};
+
+    return TargetTransformInfo::getOperandInfo(getMBAConstant(operand, type));
+  };
+
+  InstructionCost cost = 0;
+  for (auto &node : identity.nodes)
+    cost += tti.getArithmeticInstrCost(
+        node.opcode, type, TargetTransformInfo::TCK_RecipThroughput,
+        getOperandInfo(node.lhs), getOperandInfo(node.rhs));
+
+  return cost;
+}
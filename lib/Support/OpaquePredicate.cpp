@@ -0,0 +1,66 @@
+//===-- Support/OpaquePredicate.cpp - Inlinable opaque predicates ---------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Support/OpaquePredicate.h"
+
+#include "Limoncello/Support/Random.h"
+
+using namespace llvm;
+
+unsigned getOpaquePredicateCost(OpaquePredicateKind kind) {
+  switch (kind) {
+  case OpaquePredicateKind::Call:
+    // Call and return, plus the body of the (unoptimized) callee and the
+    // comparison of its result.
+    return 9;
+  case OpaquePredicateKind::Parity:
+    return 4;
+  case OpaquePredicateKind::SquareProduct:
+    return 5;
+  case OpaquePredicateKind::Squares:
+    return 6;
+  }
+
+  llvm_unreachable("Unhandled opaque predicate kind");
+}
+
+Value *createOpaquePredicate(IRBuilder<> &builder, OpaquePredicateKind kind,
+                             Value *x) {
+  assert(x->getType()->isIntegerTy(64) && "Opaque predicate needs an i64");
+
+  // All of these hold in modular (i.e. wrapping 64-bit) arithmetic as well,
+  // since 2^64 is a multiple of every modulus involved.
+  switch (kind) {
+  case OpaquePredicateKind::Call:
+    llvm_unreachable("Call-based predicates are provided by the caller");
+  case OpaquePredicateKind::Parity: {
+    auto next = builder.CreateAdd(x, builder.getInt64(1));
+    auto product = builder.CreateMul(x, next);
+    return builder.CreateICmpEQ(builder.CreateAnd(product, builder.getInt64(1)),
+                                builder.getInt64(0));
+  }
+  case OpaquePredicateKind::SquareProduct: {
+    auto next = builder.CreateAdd(x, builder.getInt64(1));
+    auto product = builder.CreateMul(x, next);
+    auto square = builder.CreateMul(product, product);
+    return builder.CreateICmpEQ(builder.CreateAnd(square, builder.getInt64(3)),
+                                builder.getInt64(0));
+  }
+  case OpaquePredicateKind::Squares: {
+    auto y = builder.CreateAdd(x, builder.getInt64(getRandomInt32()));
+    auto lhs = builder.CreateMul(x, x);
+    auto rhs = builder.CreateSub(
+        builder.CreateMul(builder.CreateMul(y, y), builder.getInt64(7)),
+        builder.getInt64(1));
+    return builder.CreateICmpNE(lhs, rhs);
+  }
+  }
+
+  llvm_unreachable("Unhandled opaque predicate kind");
+}
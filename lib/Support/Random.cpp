@@ -9,14 +9,42 @@
 
 #include "Limoncello/Support/Random.h"
 
-#include <random>
+#include <llvm/Support/xxhash.h>
 
-static std::mt19937 g_mt{std::random_device()()};
-static std::uniform_int_distribution<uint64_t>
-    g_rng(0, std::numeric_limits<uint64_t>::max());
+static unsigned g_seed = std::random_device()();
+static std::mt19937 g_mt{g_seed};
 
-void setRandomSeed(unsigned seed) { g_mt.seed(seed); }
+/// Generator used by the current thread; either the global generator, or the
+/// generator of the innermost `RandomStreamScope`.
+static thread_local std::mt19937 *t_current = &g_mt;
 
-uint8_t getRandomInt8() { return static_cast<uint8_t>(g_rng(g_mt)); }
-uint32_t getRandomInt32() { return static_cast<uint32_t>(g_rng(g_mt)); }
-uint64_t getRandomInt64() { return static_cast<uint64_t>(g_rng(g_mt)); }
+void setRandomSeed(unsigned seed) {
+  g_seed = seed;
+  g_mt.seed(seed);
+}
+
+RandomStreamScope::RandomStreamScope(llvm::StringRef pass, llvm::StringRef name)
+    : m_previous(t_current) {
+  auto passHash = llvm::xxHash64(pass);
+  auto nameHash = llvm::xxHash64(name);
+  std::seed_seq sequence{g_seed,
+                         static_cast<unsigned>(passHash),
+                         static_cast<unsigned>(passHash >> 32),
+                         static_cast<unsigned>(nameHash),
+                         static_cast<unsigned>(nameHash >> 32)};
+  m_engine.seed(sequence);
+
+  t_current = &m_engine;
+}
+
+RandomStreamScope::~RandomStreamScope() { t_current = m_previous; }
+
+static uint64_t getRandom() {
+  std::uniform_int_distribution<uint64_t> distribution(
+      0, std::numeric_limits<uint64_t>::max());
+  return distribution(*t_current);
+}
+
+uint8_t getRandomInt8() { return static_cast<uint8_t>(getRandom()); }
+uint32_t getRandomInt32() { return static_cast<uint32_t>(getRandom()); }
+uint64_t getRandomInt64() { return static_cast<uint64_t>(getRandom()); }
@@ -0,0 +1,199 @@
+//===-- Support/Report.cpp - Obfuscation remarks and reports --------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Limoncello/Support/Report.h"
+
+#include <llvm/Analysis/OptimizationRemarkEmitter.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/JSON.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+/// What a pass did to a single function, or why it didn't.
+struct FunctionRecord {
+  std::string name;
+  std::string skipReason;
+  uint64_t instructionsBefore = 0;
+  uint64_t instructionsAfter = 0;
+  std::map<std::string, uint64_t> counters;
+};
+
+/// Everything a pass did to the module.
+struct PassRecord {
+  std::string name;
+  std::vector<FunctionRecord> functions;
+  std::map<std::string, uint64_t> moduleCounters;
+};
+
+} // namespace
+
+static std::atomic<bool> g_reportEnabled = false;
+
+/// Guards the records, which partitions obfuscated by the parallel driver add
+/// to concurrently.
+static std::mutex g_reportMutex;
+static std::vector<PassRecord> g_passRecords;
+
+/// Get the record of \p pass, creating it if needed; records are kept in the
+/// order passes first report anything, i.e. pipeline order.
+static PassRecord &getPassRecord(StringRef pass) {
+  auto it = std::find_if(g_passRecords.begin(), g_passRecords.end(),
+                         [=](PassRecord const &r) { return r.name == pass; });
+  if (it != g_passRecords.end())
+    return *it;
+
+  auto &record = g_passRecords.emplace_back();
+  record.name = pass.str();
+  return record;
+}
+
+void enableReport() { g_reportEnabled = true; }
+
+bool isReportEnabled() { return g_reportEnabled; }
+
+void reportSkippedFunction(OptimizationRemarkEmitter &ore, char const *pass,
+                           Function const &func, StringRef reason) {
+  assert(!func.isDeclaration() && "Only definitions can be reported on");
+
+  ore.emit([&] {
+    return OptimizationRemarkMissed(pass, "Skipped",
+                                    DiagnosticLocation(func.getSubprogram()),
+                                    &func.getEntryBlock())
+           << "not obfuscated: " << ore::NV("Reason", reason);
+  });
+
+  if (!g_reportEnabled)
+    return;
+
+  std::lock_guard lock(g_reportMutex);
+  auto &record = getPassRecord(pass).functions.emplace_back();
+  record.name = func.getName().str();
+  record.skipReason = reason.str();
+}
+
+void reportObfuscatedFunction(OptimizationRemarkEmitter &ore, char const *pass,
+                              Function const &func, uint64_t instructionsBefore,
+                              uint64_t instructionsAfter,
+                              ArrayRef<ReportCounter> counters) {
+  assert(!func.isDeclaration() && "Only definitions can be reported on");
+
+  ore.emit([&] {
+    OptimizationRemark remark(pass, "Obfuscated",
+                              DiagnosticLocation(func.getSubprogram()),
+                              &func.getEntryBlock());
+    remark << "obfuscated, growing from "
+           << ore::NV("InstructionsBefore", instructionsBefore) << " to "
+           << ore::NV("InstructionsAfter", instructionsAfter)
+           << " instructions";
+    for (auto [name, value] : counters)
+      remark << "; " << name << ": " << ore::NV(name, value);
+    return remark;
+  });
+
+  if (!g_reportEnabled)
+    return;
+
+  std::lock_guard lock(g_reportMutex);
+  auto &record = getPassRecord(pass).functions.emplace_back();
+  record.name = func.getName().str();
+  record.instructionsBefore = instructionsBefore;
+  record.instructionsAfter = instructionsAfter;
+  for (auto [name, value] : counters)
+    record.counters[name.str()] += value;
+}
+
+void reportModuleCounters(char const *pass, ArrayRef<ReportCounter> counters) {
+  if (!g_reportEnabled)
+    return;
+
+  std::lock_guard lock(g_reportMutex);
+  auto &record = getPassRecord(pass);
+  for (auto [name, value] : counters)
+    record.moduleCounters[name.str()] += value;
+}
+
+void writeReport(raw_ostream &os, StringRef sourceFile) {
+  std::lock_guard lock(g_reportMutex);
+
+  json::OStream json(os, /*IndentSize=*/2);
+  json.object([&] {
+    json.attribute("source", sourceFile);
+    json.attributeArray("passes", [&] {
+      for (auto &pass : g_passRecords) {
+        // Partitions finish in any order; sorting keeps the report stable.
+        std::stable_sort(pass.functions.begin(), pass.functions.end(),
+                         [](auto const &lhs, auto const &rhs) {
+                           return lhs.name < rhs.name;
+                         });
+
+        uint64_t obfuscated = 0;
+        uint64_t skipped = 0;
+        uint64_t instructionsBefore = 0;
+        uint64_t instructionsAfter = 0;
+        auto totals = pass.moduleCounters;
+        for (auto const &func : pass.functions) {
+          if (!func.skipReason.empty()) {
+            ++skipped;
+            continue;
+          }
+
+          ++obfuscated;
+          instructionsBefore += func.instructionsBefore;
+          instructionsAfter += func.instructionsAfter;
+          for (auto const &[name, value] : func.counters)
+            totals[name] += value;
+        }
+
+        json.object([&] {
+          json.attribute("name", pass.name);
+          json.attributeObject("totals", [&] {
+            json.attribute("functions-obfuscated", obfuscated);
+            json.attribute("functions-skipped", skipped);
+            json.attribute("instructions-before", instructionsBefore);
+            json.attribute("instructions-after", instructionsAfter);
+            for (auto const &[name, value] : totals)
+              json.attribute(name, value);
+          });
+          json.attributeArray("functions", [&] {
+            for (auto const &func : pass.functions) {
+              json.object([&] {
+                json.attribute("name", func.name);
+                if (!func.skipReason.empty()) {
+                  json.attribute("skipped", func.skipReason);
+                  return;
+                }
+
+                json.attribute("instructions-before", func.instructionsBefore);
+                json.attribute("instructions-after", func.instructionsAfter);
+                for (auto const &[name, value] : func.counters)
+                  json.attribute(name, value);
+              });
+            }
+          });
+        });
+      }
+    });
+  });
+  os << "\n";
+}
+
+void clearReport() {
+  std::lock_guard lock(g_reportMutex);
+  g_passRecords.clear();
+}
@@ -7,23 +7,158 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "Limoncello/Analysis/FunctionSelection.h"
+#include "Limoncello/Analysis/ObfuscationCost.h"
 #include "Limoncello/Config/Config.h"
 #include "Limoncello/Pass/ArithmeticMangler.h"
 #include "Limoncello/Pass/Bloater.h"
 #include "Limoncello/Pass/ConstantMangler.h"
+#include "Limoncello/Pass/DispatchProfiler.h"
 #include "Limoncello/Pass/Flattener.h"
+#include "Limoncello/Pass/ParallelDriver.h"
+#include "Limoncello/Pass/ReportWriter.h"
 #include "Limoncello/Pass/StringObfuscator.h"
 #include "Limoncello/Support/Random.h"
+#include "Limoncello/Support/Report.h"
 
+#include <llvm/Analysis/ProfileSummaryInfo.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Passes/PassPlugin.h>
 
+#include <optional>
+
 using namespace llvm;
 
 static cl::opt<std::string> configPath("limoncello-config", cl::init(""),
                                        cl::desc("Limoncello config path"));
 
+// There is no way for a plugin to find out where the object file is going, so
+// build systems need to pass a path next to it, e.g. `-mllvm
+// -limoncello-report=$@.limoncello.json` in a Makefile rule.
+static cl::opt<std::string>
+    reportPath("limoncello-report", cl::init(""),
+               cl::desc("Path to write a JSON report of what Limoncello did "
+                        "to the module to"));
+
+static void addVerifierPass(Config const *config, ModulePassManager &pm) {
+#if 0
+  if (config->debug || !NDEBUG)
+    pm.addPass(VerifierPass());
+#endif
+}
+
+/// Add the passes which need to run after the last obfuscation pass to
+/// \p manager, i.e. the dispatch profiler and the report writer, if enabled.
+static void addTrailingPasses(Config const *config,
+                              ModulePassManager &manager) {
+  if (config->dispatchProfile.instrument)
+    manager.addPass(DispatchProfilerPass());
+  if (!reportPath.empty())
+    manager.addPass(ReportWriterPass(reportPath));
+}
+
+/// Add the flattener to \p manager, along with the module analyses it needs.
+static void addFlattenerPass(Config const *config, ModulePassManager &manager) {
+  // The flattener can only use the module's function selection (and cost
+  // model) if it has already been computed by the time the function passes
+  // run.
+  manager.addPass(RequireAnalysisPass<FunctionSelectionAnalysis, Module>());
+  if (config->hotness.isEnabled) {
+    manager.addPass(RequireAnalysisPass<ObfuscationCostAnalysis, Module>());
+    manager.addPass(RequireAnalysisPass<ProfileSummaryAnalysis, Module>());
+  }
+  manager.addPass(createModuleToFunctionPassAdaptor(FlattenerPass()));
+}
+
+/// Add all enabled obfuscation passes placed at \p extensionPoint to
+/// \p manager, in order.
+static void addObfuscationPasses(Config const *config,
+                                 ExtensionPoint extensionPoint,
+                                 ModulePassManager &manager) {
+  auto isScheduled = [=](PassConfig const &passConfig) {
+    return passConfig.isEnabled && passConfig.extensionPoint == extensionPoint;
+  };
+
+  if (isScheduled(config->stringObfuscator)) {
+    manager.addPass(StringObfuscatorPass());
+    addVerifierPass(config, manager);
+  }
+  if (isScheduled(config->bloater)) {
+    manager.addPass(BloaterPass());
+    addVerifierPass(config, manager);
+  }
+  if (isScheduled(config->flattener)) {
+    addFlattenerPass(config, manager);
+    addVerifierPass(config, manager);
+  }
+  if (isScheduled(config->constantMangler)) {
+    manager.addPass(ConstantManglerPass());
+    addVerifierPass(config, manager);
+  }
+  if (isScheduled(config->arithmeticMangler)) {
+    manager.addPass(ArithmeticManglerPass());
+
+    // XXX: Do not add a verifier pass after arithmetic mangling with stubs;
+    // the verifier will whine about using `AlwaysInline` and `OptimizeNone`
+    // together on the stub functions created in this pass.
+    if (config->arithmeticMangler.useInPlaceRewriting)
+      addVerifierPass(config, manager);
+  }
+}
+
+/// Add all obfuscation passes placed at \p extensionPoint to \p manager,
+/// through the parallel driver if configured to.
+static void addExtensionPointPasses(Config const *config,
+                                    ExtensionPoint extensionPoint,
+                                    ModulePassManager &manager) {
+  if (config->partitions > 1) {
+    manager.addPass(ParallelDriverPass(
+        config->partitions, config->threads, [=](ModulePassManager &m) {
+          addObfuscationPasses(config, extensionPoint, m);
+        }));
+    return;
+  }
+
+  addObfuscationPasses(config, extensionPoint, manager);
+}
+
+/// Add the pass named \p name to \p manager, if it is one of ours.
+///
+/// This allows running (and timing) passes in isolation with `opt -passes=`;
+/// passes run this way still only apply to the functions (and with the
+/// options) their config selects, and must be enabled there. Trailing passes
+/// run after each of them.
+static bool parsePassName(Config const *config, StringRef name,
+                          ModulePassManager &manager) {
+  if (name == "limoncello-string-obfuscator")
+    manager.addPass(StringObfuscatorPass());
+  else if (name == "limoncello-bloater")
+    manager.addPass(BloaterPass());
+  else if (name == "limoncello-flattener")
+    addFlattenerPass(config, manager);
+  else if (name == "limoncello-constant-mangler")
+    manager.addPass(ConstantManglerPass());
+  else if (name == "limoncello-arithmetic-mangler")
+    manager.addPass(ArithmeticManglerPass());
+  else
+    return false;
+
+  addTrailingPasses(config, manager);
+  return true;
+}
+
+/// Tells whether any enabled obfuscation pass is placed at \p extensionPoint.
+static bool hasExtensionPointPasses(Config *config,
+                                    ExtensionPoint extensionPoint) {
+  auto passConfigs = config->getPassConfigs();
+  return std::any_of(passConfigs.begin(), passConfigs.end(),
+                     [=](PassConfig const *passConfig) {
+                       return passConfig->isEnabled &&
+                              passConfig->extensionPoint == extensionPoint;
+                     });
+}
+
 void registerCallbacks(PassBuilder &pb) {
   auto config = Config::load(configPath);
   if (!config || !config->isValid) {
@@ -34,38 +169,54 @@ void registerCallbacks(PassBuilder &pb) {
   if (config->seed)
     setRandomSeed(config->seed);
 
-  auto addVerifierPass = [&config](ModulePassManager &pm) {
-#if 0
-    if (config->debug || !NDEBUG)
-      pm.addPass(VerifierPass());
-#endif
-  };
+  if (!reportPath.empty())
+    enableReport();
 
-  pb.registerPipelineStartEPCallback([=](ModulePassManager &manager, auto) {
-    if (config->stringObfuscator.isEnabled) {
-      manager.addPass(StringObfuscatorPass());
-      addVerifierPass(manager);
-    }
-    if (config->bloater.isEnabled) {
-      manager.addPass(BloaterPass());
-      addVerifierPass(manager);
-    }
-    if (config->flattener.isEnabled) {
-      manager.addPass(createModuleToFunctionPassAdaptor(FlattenerPass()));
-      addVerifierPass(manager);
-    }
-    if (config->constantMangler.isEnabled) {
-      manager.addPass(ConstantManglerPass());
-      addVerifierPass(manager);
-    }
-    if (config->arithmeticMangler.isEnabled) {
-      manager.addPass(ArithmeticManglerPass());
-
-      // XXX: Do not add a verifier pass after arithmetic mangling; the
-      // verifier will whine about using `AlwaysInline` and `OptimizeNone`
-      // together on the stub functions created in this pass.
-    }
+  pb.registerAnalysisRegistrationCallback([](ModuleAnalysisManager &manager) {
+    manager.registerPass([] { return FunctionSelectionAnalysis(); });
+    manager.registerPass([] { return ObfuscationCostAnalysis(); });
   });
+
+  pb.registerPipelineParsingCallback(
+      [=](StringRef name, ModulePassManager &manager,
+          ArrayRef<PassBuilder::PipelineElement>) {
+        return parsePassName(config, name, manager);
+      });
+
+  // Passes are placed at extension points in pipeline order, so trailing
+  // passes go after the extension point of the last enabled pass.
+  std::optional<ExtensionPoint> lastExtensionPoint;
+  for (auto passConfig : config->getPassConfigs()) {
+    if (passConfig->isEnabled)
+      lastExtensionPoint = passConfig->extensionPoint;
+  }
+
+  // Only hook the extension points which have passes placed at them; an
+  // empty parallel driver would still split and link the module.
+  auto addPasses = [=](ExtensionPoint extensionPoint) {
+    return [=](ModulePassManager &manager, auto) {
+      addExtensionPointPasses(config, extensionPoint, manager);
+      if (extensionPoint == lastExtensionPoint)
+        addTrailingPasses(config, manager);
+    };
+  };
+
+  if (hasExtensionPointPasses(config, ExtensionPoint::PipelineStart))
+    pb.registerPipelineStartEPCallback(
+        addPasses(ExtensionPoint::PipelineStart));
+  if (hasExtensionPointPasses(config,
+                              ExtensionPoint::PipelineEarlySimplification))
+    pb.registerPipelineEarlySimplificationEPCallback(
+        addPasses(ExtensionPoint::PipelineEarlySimplification));
+  if (hasExtensionPointPasses(config, ExtensionPoint::OptimizerEarly))
+    pb.registerOptimizerEarlyEPCallback(
+        addPasses(ExtensionPoint::OptimizerEarly));
+  if (hasExtensionPointPasses(config, ExtensionPoint::OptimizerLast))
+    pb.registerOptimizerLastEPCallback(
+        addPasses(ExtensionPoint::OptimizerLast));
+  if (hasExtensionPointPasses(config, ExtensionPoint::FullLTOLast))
+    pb.registerFullLinkTimeOptimizationLastEPCallback(
+        addPasses(ExtensionPoint::FullLTOLast));
 }
 
 PassPluginLibraryInfo getPassPluginInfo() {
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+
+from argparse import ArgumentParser
+import math
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from typing import List, Optional, Tuple
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from GenerateModule import ModuleScale, generate  # noqa: E402
+
+CONFIG_DIR = "test/Configs"
+
+# Pipeline names registered by the plugin, in pipeline order.
+PASSES = [
+    "limoncello-string-obfuscator",
+    "limoncello-bloater",
+    "limoncello-flattener",
+    "limoncello-constant-mangler",
+    "limoncello-arithmetic-mangler",
+]
+
+# Growth exponent (of time over blocks) past which a pass is flagged; linear
+# passes stay close to one, quadratic ones approach two.
+SUPERLINEAR_EXPONENT = 1.3
+
+
+class Timeout(Exception):
+    pass
+
+
+def measure(args: List[str], timeout: float) -> Tuple[float, int]:
+    """Run a command, returning its wall time (in seconds) and peak RSS (in
+    KiB, on Linux)."""
+
+    with tempfile.TemporaryFile() as errors:
+        start = time.perf_counter()
+        process = subprocess.Popen(args, stdout=subprocess.DEVNULL, stderr=errors)
+
+        # `wait4` is used rather than `getrusage(RUSAGE_CHILDREN)`, as the
+        # latter only reports the largest RSS of any child so far.
+        deadline = start + timeout
+        while True:
+            pid, status, usage = os.wait4(process.pid, os.WNOHANG)
+            if pid:
+                break
+            if time.perf_counter() > deadline:
+                process.kill()
+                os.wait4(process.pid, 0)
+                raise Timeout()
+            time.sleep(0.01)
+
+        elapsed = time.perf_counter() - start
+        if os.waitstatus_to_exitcode(status) != 0:
+            errors.seek(0)
+            sys.stderr.write(errors.read().decode(errors="replace"))
+            raise subprocess.CalledProcessError(os.waitstatus_to_exitcode(status), args)
+
+    return elapsed, usage.ru_maxrss
+
+
+def run_opt(
+    opt: str, plugin: str, config: str, passes: str, input_path: str, timeout: float
+) -> Tuple[float, int]:
+    return measure(
+        [
+            opt,
+            f"-load-pass-plugin={plugin}",
+            f"-limoncello-config={config}",
+            f"-passes={passes}",
+            "-disable-output",
+            input_path,
+        ],
+        timeout,
+    )
+
+
+def get_growth(
+    previous: Optional[Tuple[int, float]], blocks: int, seconds: float
+) -> Optional[float]:
+    """Get the exponent `k` such that time grows as `blocks^k` since the
+    previous size."""
+
+    if previous is None:
+        return None
+
+    previous_blocks, previous_seconds = previous
+    if previous_seconds <= 0 or seconds <= 0:
+        return None
+
+    return math.log(seconds / previous_seconds) / math.log(blocks / previous_blocks)
+
+
+if __name__ == "__main__":
+    parser = ArgumentParser()
+    parser.add_argument(
+        "-o",
+        dest="opt",
+        type=str,
+        help="path to opt",
+        metavar="OPT",
+        required=True,
+    )
+    parser.add_argument(
+        "-p",
+        dest="plugin",
+        type=str,
+        help="path to Limoncello plugin",
+        metavar="PLUGIN",
+        required=True,
+    )
+    parser.add_argument(
+        "-c",
+        dest="config",
+        type=str,
+        help="config enabling the passes to measure",
+        metavar="CONFIG",
+        default=f"{CONFIG_DIR}/Everything.yml",
+    )
+    parser.add_argument(
+        "-b",
+        dest="blocks",
+        type=str,
+        help="comma-separated blocks per function to measure",
+        metavar="N,...",
+        default="10,100,1000,10000,100000",
+    )
+    parser.add_argument(
+        "-f", dest="functions", type=int, help="number of functions", metavar="N", default=1
+    )
+    parser.add_argument(
+        "-a",
+        dest="arithmetic_density",
+        type=int,
+        help="number of arithmetic operations per block",
+        metavar="N",
+        default=4,
+    )
+    parser.add_argument(
+        "-n",
+        dest="repetitions",
+        type=int,
+        help="number of runs per measurement",
+        metavar="N",
+        default=3,
+    )
+    parser.add_argument(
+        "-t",
+        dest="timeout",
+        type=float,
+        help="seconds to give up on a single run after",
+        metavar="SECONDS",
+        default=600,
+    )
+    parser.add_argument(
+        "--passes",
+        dest="passes",
+        type=str,
+        help="comma-separated passes to measure",
+        metavar="PASS,...",
+        default=",".join(PASSES),
+    )
+
+    args = parser.parse_args()
+    sizes = [int(size) for size in args.blocks.split(",")]
+    passes = args.passes.split(",")
+
+    def best_of(passes: str, input_path: str) -> Tuple[float, int]:
+        runs = [
+            run_opt(args.opt, args.plugin, args.config, passes, input_path, args.timeout)
+            for _ in range(args.repetitions)
+        ]
+        return min(r[0] for r in runs), min(r[1] for r in runs)
+
+    with tempfile.TemporaryDirectory() as build_dir:
+        # Generate (and parse) every module once up front; time spent reading
+        # the module is measured separately and subtracted from each pass.
+        inputs = {}
+        baselines = {}
+        for blocks in sizes:
+            scale = ModuleScale(
+                functions=args.functions,
+                blocks=blocks,
+                strings=max(blocks // 10, 1),
+                arithmetic_density=args.arithmetic_density,
+            )
+
+            text_path = os.path.join(build_dir, f"{blocks}.ll")
+            with open(text_path, "w") as f:
+                generate(f, scale)
+
+            inputs[blocks] = os.path.join(build_dir, f"{blocks}.bc")
+            subprocess.run(
+                [args.opt, "-passes=no-op-module", "-o", inputs[blocks], text_path], check=True
+            )
+            baselines[blocks] = best_of("no-op-module", inputs[blocks])
+
+        print(
+            f"{'pass':<30} {'blocks':>8} {'time':>10} {'net':>10} {'peak RSS':>10} "
+            f"{'net RSS':>10} {'growth':>8}"
+        )
+        for name in passes:
+            previous = None
+            for blocks in sizes:
+                row = f"{name:<30} {blocks:>8}"
+                try:
+                    seconds, rss = best_of(name, inputs[blocks])
+                except Timeout:
+                    print(row + f" {'timeout':>10}")
+                    break
+
+                base_seconds, base_rss = baselines[blocks]
+                net_seconds = max(seconds - base_seconds, 0)
+                growth = get_growth(previous, blocks, net_seconds)
+                previous = (blocks, net_seconds)
+
+                row += f" {seconds * 1e3:>8.1f}ms {net_seconds * 1e3:>8.1f}ms"
+                row += f" {rss / 1024:>8.1f}MB {max(rss - base_rss, 0) / 1024:>8.1f}MB"
+                if growth is not None:
+                    row += f" {growth:>8.2f}"
+                    if growth > SUPERLINEAR_EXPONENT:
+                        row += "  superlinear"
+                print(row)
@@ -0,0 +1,91 @@
+//===-- DeobfuscateBenchmark.c - String deobfuscation microbenchmark ------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures the throughput of every deobfuscation kernel variant supported by
+// the host, both over one large buffer and over a table of short strings.
+//
+//===----------------------------------------------------------------------===//
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "StringObfuscatorRuntime.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+  LargeBufferSize = 64 << 20,
+  ShortStringSize = 24,
+  Repetitions = 16,
+};
+
+typedef struct {
+  char const *name;
+  DeobfuscateFn fn;
+  int isSupported;
+} Variant;
+
+static double getTime(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/// Get the throughput (in bytes per second) of \p fn over \p buffer, processed
+/// in chunks of \p chunkSize bytes as if each were an individual string.
+static double measure(DeobfuscateFn fn, char *buffer, size_t size,
+                      size_t chunkSize) {
+  double start = getTime();
+  for (int r = 0; r < Repetitions; ++r)
+    for (size_t i = 0; i < size; i += chunkSize)
+      fn(buffer + i, chunkSize < size - i ? chunkSize : size - i, (uint8_t)r);
+  double elapsed = getTime() - start;
+
+  return (double)size * Repetitions / elapsed;
+}
+
+int main(void) {
+  Variant variants[] = {
+      {"bytes", deobfuscateBytes, 1},
+      {"words", deobfuscateWords, 1},
+#if LIMONCELLO_RUNTIME_X86
+      {"sse2", deobfuscateSSE2, hasSSE2Support()},
+      {"avx2", deobfuscateAVX2, hasAVX2Support()},
+      {"avx512", deobfuscateAVX512, hasAVX512Support()},
+#elif LIMONCELLO_RUNTIME_NEON
+      {"neon", deobfuscateNEON, 1},
+#endif
+      {"selected", deobfuscateXOR, 1},
+  };
+
+  char *buffer = malloc(LargeBufferSize);
+  if (!buffer)
+    return 1;
+  memset(buffer, 'A', LargeBufferSize);
+
+  printf("%-10s %16s %16s\n", "variant", "large (MB/s)", "short (MB/s)");
+  for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); ++i) {
+    if (!variants[i].isSupported) {
+      printf("%-10s %16s %16s\n", variants[i].name, "-", "-");
+      continue;
+    }
+
+    double large =
+        measure(variants[i].fn, buffer, LargeBufferSize, LargeBufferSize);
+    double small =
+        measure(variants[i].fn, buffer, LargeBufferSize, ShortStringSize);
+    printf("%-10s %16.1f %16.1f\n", variants[i].name, large / 1e6,
+           small / 1e6);
+  }
+
+  free(buffer);
+  return 0;
+}
@@ -0,0 +1,65 @@
+//===-- FlattenerBenchmark.c - Flattened dispatch benchmark ---------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// A single function with roughly a thousand blocks, meant to be built with
+// different flattener configurations (see FlattenerBenchmark.py) to compare
+// the cost of dispatching between blocks.
+//
+//===----------------------------------------------------------------------===//
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum {
+  /// Number of steps in `runSteps`, each of which is an if/else diamond.
+  StepCount = 256,
+
+  DefaultIterations = 200000,
+};
+
+#define STEP(n)                                                                \
+  if ((x >> ((n) % 29)) & 1)                                                   \
+    x = x * 2654435761u + (n);                                                 \
+  else                                                                         \
+    x ^= x >> 3;
+#define STEP4(n) STEP(n) STEP(n + 1) STEP(n + 2) STEP(n + 3)
+#define STEP16(n) STEP4(n) STEP4(n + 4) STEP4(n + 8) STEP4(n + 12)
+#define STEP64(n) STEP16(n) STEP16(n + 16) STEP16(n + 32) STEP16(n + 48)
+#define STEP256(n) STEP64(n) STEP64(n + 64) STEP64(n + 128) STEP64(n + 192)
+
+__attribute__((noinline)) uint32_t runSteps(uint32_t x, unsigned iterations) {
+  for (unsigned i = 0; i < iterations; ++i) {
+    STEP256(0)
+  }
+
+  return x;
+}
+
+static double getTime(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? (unsigned)atoi(argv[1]) : DefaultIterations;
+
+  double start = getTime();
+  uint32_t result = runSteps((uint32_t)argc, iterations);
+  double elapsed = getTime() - start;
+
+  // Printing the result keeps the work from being optimized out; the time per
+  // step is what the benchmark script cares about.
+  printf("%u %.3f\n", result, elapsed * 1e9 / ((double)iterations * StepCount));
+  return 0;
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+
+from argparse import ArgumentParser
+import os
+import subprocess
+import tempfile
+from typing import Optional
+
+SOURCE_PATH = "test/Benchmarks/FlattenerBenchmark.c"
+CONFIG_DIR = "test/Configs"
+
+# Configurations to compare; `None` is the unobfuscated baseline.
+CONFIGS = [None, "Flattener", "FlattenerRegions", "FlattenerThreaded"]
+
+
+def build(clang: str, plugin: str, config: Optional[str], output_path: str):
+    args = [clang, "-O2"]
+    if config:
+        args += [
+            f"-fpass-plugin={plugin}",
+            "-mllvm",
+            f"-limoncello-config={CONFIG_DIR}/{config}.yml",
+        ]
+    args += ["-o", output_path, SOURCE_PATH]
+
+    subprocess.run(args, check=True)
+
+
+def run(binary_path: str, iterations: int, repetitions: int) -> float:
+    """Get the best time per step (in nanoseconds) over all repetitions."""
+
+    best = float("inf")
+    for _ in range(repetitions):
+        result = subprocess.run(
+            [binary_path, str(iterations)], check=True, capture_output=True, text=True
+        )
+        best = min(best, float(result.stdout.split()[1]))
+
+    return best
+
+
+if __name__ == "__main__":
+    parser = ArgumentParser()
+    parser.add_argument(
+        "-c",
+        dest="clang",
+        type=str,
+        help="path to Clang",
+        metavar="CLANG",
+        required=True,
+    )
+    parser.add_argument(
+        "-p",
+        dest="plugin",
+        type=str,
+        help="path to Limoncello plugin",
+        metavar="PLUGIN",
+        required=True,
+    )
+    parser.add_argument(
+        "-n",
+        dest="iterations",
+        type=int,
+        help="number of iterations per run",
+        metavar="N",
+        default=200000,
+    )
+    parser.add_argument(
+        "-r",
+        dest="repetitions",
+        type=int,
+        help="number of runs per configuration",
+        metavar="N",
+        default=5,
+    )
+
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as build_dir:
+        baseline = None
+        print(f"{'config':<20} {'ns/step':>10} {'overhead':>10} {'slowdown':>10}")
+        for config in CONFIGS:
+            name = config or "Baseline"
+            binary_path = os.path.join(build_dir, name)
+            build(args.clang, args.plugin, config, binary_path)
+
+            time = run(binary_path, args.iterations, args.repetitions)
+            if baseline is None:
+                baseline = time
+
+            print(
+                f"{name:<20} {time:>10.3f} {time - baseline:>10.3f} {time / baseline:>9.2f}x"
+            )
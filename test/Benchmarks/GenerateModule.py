@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+
+"""Generate synthetic LLVM IR modules of a given scale.
+
+Every function is a chain of blocks, each of which loads a running value from
+the stack, applies a number of arithmetic operations with constant operands to
+it, stores it back, and branches one or two blocks ahead based on it; some
+blocks also pass one of the module's strings to `puts`. This is roughly what
+Clang emits at -O0, which is what the obfuscation passes see by default.
+"""
+
+from argparse import ArgumentParser
+from dataclasses import dataclass
+import random
+import string
+import sys
+from typing import TextIO
+
+# Binary operations used for arithmetic, with the range of constants to use as
+# their right-hand side.
+OPERATIONS = [
+    ("add", 1, 1 << 20),
+    ("sub", 1, 1 << 20),
+    ("mul", 3, 1 << 10),
+    ("xor", 1, (1 << 31) - 1),
+    ("and", 1, (1 << 31) - 1),
+    ("or", 1, (1 << 31) - 1),
+]
+
+
+@dataclass
+class ModuleScale:
+    functions: int = 1
+    blocks: int = 100
+    strings: int = 10
+
+    # Number of arithmetic operations per block.
+    arithmetic_density: int = 4
+
+    seed: int = 0
+
+
+def write_strings(out: TextIO, scale: ModuleScale, rng: random.Random):
+    for i in range(scale.strings):
+        text = "".join(rng.choices(string.ascii_letters + " ", k=rng.randint(8, 48)))
+        out.write(
+            f'@.str.{i} = private unnamed_addr constant [{len(text) + 1} x i8] c"{text}\\00", align 1\n'
+        )
+
+
+def write_function(
+    out: TextIO, scale: ModuleScale, index: int, first_block: int, rng: random.Random
+):
+    """Emit function number `index`, whose blocks are numbered module-wide from
+    `first_block` (which decides which of them use strings)."""
+
+    # Spread string uses evenly over all of the blocks in the module.
+    total_blocks = scale.functions * scale.blocks
+    string_stride = max(total_blocks // scale.strings, 1) if scale.strings else 0
+
+    out.write(f"\ndefine i32 @f{index}(i32 %arg) {{\n")
+    out.write("entry:\n")
+    out.write("  %x = alloca i32, align 4\n")
+    out.write("  store i32 %arg, ptr %x, align 4\n")
+    out.write("  br label %b0\n")
+
+    for block in range(scale.blocks):
+        out.write(f"\nb{block}:\n")
+        out.write(f"  %v{block}.0 = load i32, ptr %x, align 4\n")
+
+        value = f"%v{block}.0"
+        for op in range(scale.arithmetic_density):
+            opcode, low, high = rng.choice(OPERATIONS)
+            result = f"%v{block}.{op + 1}"
+            out.write(f"  {result} = {opcode} i32 {value}, {rng.randint(low, high)}\n")
+            value = result
+
+        module_block = first_block + block
+        if string_stride and module_block % string_stride == 0:
+            string_index = (module_block // string_stride) % scale.strings
+            out.write(f"  %s{block} = call i32 @puts(ptr @.str.{string_index})\n")
+
+        if block == scale.blocks - 1:
+            out.write(f"  ret i32 {value}\n")
+            continue
+
+        out.write(f"  store i32 {value}, ptr %x, align 4\n")
+        out.write(f"  %c{block} = icmp ult i32 {value}, {rng.randint(1, (1 << 31) - 1)}\n")
+        near = block + 1
+        far = min(block + 2, scale.blocks - 1)
+        out.write(f"  br i1 %c{block}, label %b{near}, label %b{far}\n")
+
+    out.write("}\n")
+
+
+def generate(out: TextIO, scale: ModuleScale):
+    rng = random.Random(scale.seed)
+
+    out.write("; Generated by GenerateModule.py\n")
+    out.write(
+        f"; functions={scale.functions} blocks={scale.blocks} "
+        f"strings={scale.strings} arithmetic-density={scale.arithmetic_density}\n\n"
+    )
+
+    write_strings(out, scale, rng)
+    out.write("\ndeclare i32 @puts(ptr)\n")
+
+    for i in range(scale.functions):
+        write_function(out, scale, i, i * scale.blocks, rng)
+
+
+if __name__ == "__main__":
+    parser = ArgumentParser()
+    parser.add_argument(
+        "-f", dest="functions", type=int, help="number of functions", metavar="N", default=1
+    )
+    parser.add_argument(
+        "-b",
+        dest="blocks",
+        type=int,
+        help="number of blocks per function",
+        metavar="N",
+        default=100,
+    )
+    parser.add_argument(
+        "-s", dest="strings", type=int, help="number of strings", metavar="N", default=10
+    )
+    parser.add_argument(
+        "-a",
+        dest="arithmetic_density",
+        type=int,
+        help="number of arithmetic operations per block",
+        metavar="N",
+        default=4,
+    )
+    parser.add_argument("--seed", dest="seed", type=int, help="random seed", default=0)
+    parser.add_argument(
+        "-o", dest="output", type=str, help="output path (stdout if not given)", metavar="PATH"
+    )
+
+    args = parser.parse_args()
+    if args.blocks < 1:
+        parser.error("functions need at least one block")
+
+    scale = ModuleScale(
+        functions=args.functions,
+        blocks=args.blocks,
+        strings=args.strings,
+        arithmetic_density=args.arithmetic_density,
+        seed=args.seed,
+    )
+
+    if args.output:
+        with open(args.output, "w") as f:
+            generate(f, scale)
+    else:
+        generate(sys.stdout, scale)
@@ -0,0 +1,136 @@
+//===-- PerfRun.c - Run a command under hardware performance counters -----===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// Usage: PerfRun <command> [args...]
+//
+// Runs the command with its counters only enabled from the point it is exec'd
+// (so none of the launcher itself is counted), then prints one `name value`
+// line per counter to stderr, prefixed with `perf:`. Counters the host can't
+// provide (e.g. in a VM without a virtual PMU) are reported as -1; wall time
+// is always available.
+//
+//===----------------------------------------------------------------------===//
+
+#define _GNU_SOURCE
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  char const *name;
+  uint32_t type;
+  uint64_t config;
+  int fd;
+} Counter;
+
+static Counter counters[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1},
+    {"icache-misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+     -1},
+};
+
+enum { CounterCount = sizeof(counters) / sizeof(counters[0]) };
+
+static int openCounter(Counter const *counter, pid_t pid) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = counter->type;
+  attr.config = counter->config;
+  attr.disabled = 1;
+  attr.enable_on_exec = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+/// Read \p counter, scaling it up if it was multiplexed with other counters.
+static int64_t readCounter(Counter const *counter) {
+  uint64_t values[3];
+  if (counter->fd < 0 ||
+      read(counter->fd, values, sizeof(values)) != sizeof(values) ||
+      values[2] == 0)
+    return -1;
+
+  return (int64_t)((double)values[0] * (double)values[1] / (double)values[2]);
+}
+
+static double getTime(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <command> [args...]\n", argv[0]);
+    return 2;
+  }
+
+  // The child waits for the counters to be attached before exec'ing.
+  int ready[2];
+  if (pipe(ready) != 0) {
+    perror("pipe");
+    return 2;
+  }
+
+  double start = getTime();
+  pid_t child = fork();
+  if (child < 0) {
+    perror("fork");
+    return 2;
+  }
+  if (child == 0) {
+    char byte;
+    close(ready[1]);
+    if (read(ready[0], &byte, 1) != 1)
+      _exit(127);
+
+    execvp(argv[1], argv + 1);
+    perror("execvp");
+    _exit(127);
+  }
+
+  close(ready[0]);
+  for (int i = 0; i < CounterCount; ++i)
+    counters[i].fd = openCounter(&counters[i], child);
+  if (write(ready[1], "", 1) != 1) {
+    perror("write");
+    return 2;
+  }
+  close(ready[1]);
+
+  int status;
+  if (waitpid(child, &status, 0) < 0) {
+    perror("waitpid");
+    return 2;
+  }
+  double elapsed = getTime() - start;
+
+  for (int i = 0; i < CounterCount; ++i)
+    fprintf(stderr, "perf: %s %lld\n", counters[i].name,
+            (long long)readCounter(&counters[i]));
+  fprintf(stderr, "perf: wall-ns %lld\n", (long long)(elapsed * 1e9));
+
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
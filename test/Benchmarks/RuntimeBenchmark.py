@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+
+from argparse import ArgumentParser
+from dataclasses import dataclass
+from fnmatch import fnmatch
+import math
+import os
+import struct
+import subprocess
+import tempfile
+from typing import Dict, List, Optional
+
+WORKLOAD_DIR = "test/Benchmarks/Workloads"
+CONFIG_DIR = "test/Configs"
+
+WORKLOADS = ["TightLoops", "SwitchParser", "Recursion", "StringHeavy"]
+
+# Configurations enabling a single pass each, followed by everything at once;
+# any other config in `CONFIG_DIR` can be selected with `-f`. None of them may
+# use patterns, since no workload function would match them, and the workload
+# would be measured without obfuscation.
+DEFAULT_CONFIGS = [
+    "StringObfuscator",
+    "Bloater",
+    "Flattener",
+    "ConstantMangler",
+    "ArithmeticMangler",
+    "Everything",
+]
+
+# Counters reported by `PerfRun`, in the order they are shown.
+COUNTERS = ["cycles", "instructions", "branch-misses", "icache-misses", "wall-ns"]
+
+# `sh_flags` bit marking a section as executable.
+SHF_EXECINSTR = 0x4
+
+
+@dataclass
+class Measurement:
+    output: str
+    counters: Dict[str, int]
+    code_size: int
+
+
+def get_code_size(path: str) -> int:
+    """Get the total size of the executable sections of an ELF file."""
+
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF":
+        raise ValueError(f"{path} is not an ELF file")
+
+    is_64_bit = data[4] == 2
+    endian = "<" if data[5] == 1 else ">"
+    if is_64_bit:
+        (section_offset,) = struct.unpack_from(endian + "Q", data, 0x28)
+        entry_size, entry_count = struct.unpack_from(endian + "HH", data, 0x3A)
+    else:
+        (section_offset,) = struct.unpack_from(endian + "I", data, 0x20)
+        entry_size, entry_count = struct.unpack_from(endian + "HH", data, 0x2E)
+
+    total = 0
+    for i in range(entry_count):
+        entry = section_offset + i * entry_size
+        if is_64_bit:
+            (flags,) = struct.unpack_from(endian + "Q", data, entry + 8)
+            (size,) = struct.unpack_from(endian + "Q", data, entry + 32)
+        else:
+            (flags,) = struct.unpack_from(endian + "I", data, entry + 8)
+            (size,) = struct.unpack_from(endian + "I", data, entry + 20)
+
+        if flags & SHF_EXECINSTR:
+            total += size
+
+    return total
+
+
+def build(clang: str, plugin: str, config: Optional[str], source_path: str, output_path: str):
+    args = [clang, "-O2"]
+    if config:
+        args += [
+            f"-fpass-plugin={plugin}",
+            "-mllvm",
+            f"-limoncello-config={CONFIG_DIR}/{config}.yml",
+        ]
+    args += ["-o", output_path, source_path]
+
+    subprocess.run(args, check=True)
+
+
+def run(perf_run: str, binary_path: str, repetitions: int) -> Measurement:
+    """Run a binary under `PerfRun`, keeping the lowest value of each counter
+    over all repetitions."""
+
+    output = None
+    counters: Dict[str, int] = {}
+    for _ in range(repetitions):
+        result = subprocess.run(
+            [perf_run, binary_path], check=True, capture_output=True, text=True
+        )
+        output = result.stdout
+
+        for line in result.stderr.splitlines():
+            if not line.startswith("perf: "):
+                continue
+
+            name, value = line[len("perf: ") :].split()
+            value = int(value)
+            if value >= 0:
+                counters[name] = min(counters.get(name, value), value)
+
+    return Measurement(output or "", counters, get_code_size(binary_path))
+
+
+def format_ratio(value: Optional[int], baseline: Optional[int]) -> str:
+    if value is None or not baseline:
+        return "n/a"
+
+    return f"{value / baseline:.2f}x"
+
+
+def geometric_mean(values: List[float]) -> Optional[float]:
+    if not values:
+        return None
+
+    return math.exp(sum(math.log(v) for v in values) / len(values))
+
+
+if __name__ == "__main__":
+    parser = ArgumentParser()
+    parser.add_argument(
+        "-c",
+        dest="clang",
+        type=str,
+        help="path to Clang",
+        metavar="CLANG",
+        required=True,
+    )
+    parser.add_argument(
+        "-p",
+        dest="plugin",
+        type=str,
+        help="path to Limoncello plugin",
+        metavar="PLUGIN",
+        required=True,
+    )
+    parser.add_argument(
+        "-r",
+        dest="perf_run",
+        type=str,
+        help="path to the PerfRun launcher",
+        metavar="PERFRUN",
+        required=True,
+    )
+    parser.add_argument(
+        "-f",
+        dest="filter",
+        type=str,
+        help="filter configs to measure (all of them, not only the defaults)",
+        metavar="FILTER",
+    )
+    parser.add_argument(
+        "-n",
+        dest="repetitions",
+        type=int,
+        help="number of runs per build",
+        metavar="N",
+        default=5,
+    )
+
+    args = parser.parse_args()
+
+    configs = DEFAULT_CONFIGS
+    if args.filter:
+        configs = sorted(
+            name
+            for name in (f[: -len(".yml")] for f in os.listdir(CONFIG_DIR) if f.endswith(".yml"))
+            if name != "None" and fnmatch(name, args.filter)
+        )
+
+    # Slowdown (in cycles, or wall time without hardware counters) and code
+    # size ratio of every workload, by config.
+    slowdowns: Dict[str, List[float]] = {config: [] for config in configs}
+    size_ratios: Dict[str, List[float]] = {config: [] for config in configs}
+
+    with tempfile.TemporaryDirectory() as build_dir:
+        columns = ["cycles", "insns", "br-miss", "i$-miss", "wall", "size"]
+        print(f"{'workload':<14} {'config':<26}" + "".join(f" {c:>8}" for c in columns))
+
+        for workload in WORKLOADS:
+            source_path = os.path.join(WORKLOAD_DIR, f"{workload}.c")
+            baseline_path = os.path.join(build_dir, workload)
+            build(args.clang, args.plugin, None, source_path, baseline_path)
+            baseline = run(args.perf_run, baseline_path, args.repetitions)
+
+            print(
+                f"{workload:<14} {'(baseline)':<26}"
+                + "".join(
+                    f" {baseline.counters.get(c, 'n/a'):>8}"
+                    if c != "wall-ns"
+                    else f" {baseline.counters[c] / 1e6:>6.0f}ms"
+                    for c in COUNTERS
+                )
+                + f" {baseline.code_size:>8}"
+            )
+
+            for config in configs:
+                binary_path = os.path.join(build_dir, f"{workload}.{config}")
+                build(args.clang, args.plugin, config, source_path, binary_path)
+                measurement = run(args.perf_run, binary_path, args.repetitions)
+
+                row = f"{workload:<14} {config:<26}"
+                for counter in COUNTERS:
+                    row += f" {format_ratio(measurement.counters.get(counter), baseline.counters.get(counter)):>8}"
+                row += f" {format_ratio(measurement.code_size, baseline.code_size):>8}"
+
+                # Obfuscation must never change what a program does.
+                if measurement.output != baseline.output:
+                    row += "  OUTPUT MISMATCH"
+                print(row)
+
+                reference = "cycles" if "cycles" in baseline.counters else "wall-ns"
+                if baseline.counters.get(reference) and reference in measurement.counters:
+                    slowdowns[config].append(
+                        measurement.counters[reference] / baseline.counters[reference]
+                    )
+                size_ratios[config].append(measurement.code_size / baseline.code_size)
+
+    print()
+    print(f"{'config':<26} {'slowdown':>10} {'size':>10}  (geometric mean over workloads)")
+    for config in configs:
+        slowdown = geometric_mean(slowdowns[config])
+        size = geometric_mean(size_ratios[config])
+        print(
+            f"{config:<26}"
+            + (f" {slowdown:>9.2f}x" if slowdown else f" {'n/a':>10}")
+            + (f" {size:>9.2f}x" if size else f" {'n/a':>10}")
+        )
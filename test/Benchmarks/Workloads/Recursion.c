@@ -0,0 +1,65 @@
+//===-- Recursion.c - Call-heavy recursive workload -----------------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// Deep recursion over tiny functions, where any per-call overhead (prologues,
+// extra stack traffic, opaque loads on entry) is multiplied by the call count.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+  FibonacciIndex = 24,
+  TreeDepth = 16,
+  DefaultIterations = 400,
+};
+
+__attribute__((noinline)) static uint64_t fibonacci(unsigned n) {
+  if (n < 2)
+    return n;
+
+  return fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+/// Walk an implicit complete binary tree, hashing node indices on the way.
+__attribute__((noinline)) static uint64_t walk(uint64_t node, unsigned depth) {
+  if (depth == 0)
+    return (node * 0x9e3779b97f4a7c15ull) >> 32;
+
+  uint64_t left = walk(node * 2 + 1, depth - 1);
+  uint64_t right = walk(node * 2 + 2, depth - 1);
+  return (left ^ (right * 31)) + node;
+}
+
+/// Mutually recursive parity check, one level per call.
+__attribute__((noinline)) static int isOdd(unsigned n);
+
+__attribute__((noinline)) static int isEven(unsigned n) {
+  return n == 0 ? 1 : isOdd(n - 1);
+}
+
+__attribute__((noinline)) static int isOdd(unsigned n) {
+  return n == 0 ? 0 : isEven(n - 1);
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? (unsigned)atoi(argv[1]) : DefaultIterations;
+
+  uint64_t result = 0;
+  for (unsigned i = 0; i < iterations; ++i) {
+    result += fibonacci(FibonacciIndex + (i & 1));
+    result ^= walk(i, TreeDepth);
+    result += (uint64_t)isEven(10000 + i);
+  }
+
+  printf("%llu\n", (unsigned long long)result);
+  return 0;
+}
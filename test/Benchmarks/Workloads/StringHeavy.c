@@ -0,0 +1,86 @@
+//===-- StringHeavy.c - String literal-heavy workload ---------------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// Keyword lookups and message formatting against a few dozen string literals,
+// both on startup and in the hot loop; this is what the string obfuscator's
+// startup (or on-first-use) decryption and table layout affect.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  WordCount = 1024,
+  DefaultIterations = 2000,
+};
+
+static char const *const keywords[] = {
+    "auto",     "break",    "case",     "char",   "const",    "continue",
+    "default",  "do",       "double",   "else",   "enum",     "extern",
+    "float",    "for",      "goto",     "if",     "inline",   "int",
+    "long",     "register", "restrict", "return", "short",    "signed",
+    "sizeof",   "static",   "struct",   "switch", "typedef",  "union",
+    "unsigned", "void",     "volatile", "while",  "_Alignas", "_Bool",
+};
+
+enum { KeywordCount = sizeof(keywords) / sizeof(keywords[0]) };
+
+static char const *words[WordCount];
+
+/// Get the index of \p word in the keyword table, or -1 if it isn't there.
+__attribute__((noinline)) static int findKeyword(char const *word) {
+  for (int i = 0; i < KeywordCount; ++i) {
+    if (strcmp(word, keywords[i]) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+__attribute__((noinline)) static size_t describe(char *buffer, size_t size,
+                                                 char const *word, int index) {
+  int length;
+  if (index < 0)
+    length = snprintf(buffer, size, "'%s' is an identifier", word);
+  else
+    length = snprintf(buffer, size, "'%s' is keyword #%d", word, index);
+
+  return length > 0 ? (size_t)length : 0;
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? (unsigned)atoi(argv[1]) : DefaultIterations;
+
+  // Mix keywords with identifiers which share a prefix with one, so that the
+  // comparisons don't all fail on the first character.
+  static char const *const identifiers[] = {"autumn", "breakfast", "cases",
+                                            "dodge", "format", "integer"};
+  uint32_t seed = 7;
+  for (unsigned i = 0; i < WordCount; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    words[i] = (seed >> 16) % 3 ? keywords[(seed >> 8) % KeywordCount]
+                                : identifiers[(seed >> 8) % 6];
+  }
+
+  uint64_t result = 0;
+  char buffer[64];
+  for (unsigned i = 0; i < iterations; ++i) {
+    for (unsigned j = 0; j < WordCount; ++j) {
+      int index = findKeyword(words[j]);
+      result += describe(buffer, sizeof(buffer), words[j], index);
+      result += (uint64_t)(index + 1) * (unsigned char)buffer[1];
+    }
+  }
+
+  printf("%llu\n", (unsigned long long)result);
+  return 0;
+}
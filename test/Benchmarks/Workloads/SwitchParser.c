@@ -0,0 +1,147 @@
+//===-- SwitchParser.c - Switch-heavy tokenizer workload ------------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// A hand-written tokenizer driven by a switch over its state and the class of
+// each character, run over generated source text; lots of small blocks and
+// unpredictable branches, which is where the flattener and bloater show up.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+  InputSize = 1 << 16,
+  DefaultIterations = 1000,
+};
+
+typedef enum {
+  StateStart,
+  StateNumber,
+  StateIdentifier,
+  StateOperator,
+  StateComment,
+  StateString,
+} State;
+
+typedef struct {
+  uint64_t numbers;
+  uint64_t identifiers;
+  uint64_t operators;
+  uint64_t strings;
+  uint64_t sum;
+} Counts;
+
+static char input[InputSize];
+
+static void generateInput(void) {
+  static char const alphabet[] = "abcxyz0123456789+-*/=<>(){};\"# \n\t";
+
+  uint32_t seed = 42;
+  for (unsigned i = 0; i < InputSize - 1; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    input[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+  }
+}
+
+__attribute__((noinline)) static void tokenize(char const *text,
+                                               Counts *counts) {
+  State state = StateStart;
+  uint64_t value = 0;
+
+  for (char const *c = text;; ++c) {
+    switch (state) {
+    case StateStart:
+      switch (*c) {
+      case '\0':
+        return;
+      case '0' ... '9':
+        value = (uint64_t)(*c - '0');
+        state = StateNumber;
+        break;
+      case 'a' ... 'z':
+        state = StateIdentifier;
+        break;
+      case '+':
+      case '-':
+      case '*':
+      case '/':
+      case '=':
+      case '<':
+      case '>':
+        state = StateOperator;
+        break;
+      case '#':
+        state = StateComment;
+        break;
+      case '"':
+        state = StateString;
+        break;
+      default:
+        break;
+      }
+      break;
+    case StateNumber:
+      if (*c >= '0' && *c <= '9') {
+        value = value * 10 + (uint64_t)(*c - '0');
+      } else {
+        ++counts->numbers;
+        counts->sum += value;
+        state = StateStart;
+        --c;
+      }
+      break;
+    case StateIdentifier:
+      if (!((*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9'))) {
+        ++counts->identifiers;
+        state = StateStart;
+        --c;
+      }
+      break;
+    case StateOperator:
+      // Two-character operators (`<=`, `==`, ...) are a single token.
+      ++counts->operators;
+      state = StateStart;
+      if (*c != '=')
+        --c;
+      break;
+    case StateComment:
+      if (*c == '\n' || *c == '\0') {
+        state = StateStart;
+        --c;
+      }
+      break;
+    case StateString:
+      if (*c == '"' || *c == '\0') {
+        ++counts->strings;
+        state = StateStart;
+        if (*c == '\0')
+          --c;
+      }
+      break;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? (unsigned)atoi(argv[1]) : DefaultIterations;
+
+  generateInput();
+
+  Counts counts = {0};
+  for (unsigned i = 0; i < iterations; ++i)
+    tokenize(input, &counts);
+
+  printf("%llu %llu %llu %llu %llu\n", (unsigned long long)counts.numbers,
+         (unsigned long long)counts.identifiers,
+         (unsigned long long)counts.operators,
+         (unsigned long long)counts.strings, (unsigned long long)counts.sum);
+  return 0;
+}
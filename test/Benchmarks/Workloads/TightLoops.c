@@ -0,0 +1,74 @@
+//===-- TightLoops.c - Arithmetic-heavy loop workload ---------------------===//
+//
+// Copyright (c) 2023 Jon Palmisciano. All rights reserved.
+//
+// Use of this source code is governed by the BSD 3-Clause license; a full copy
+// of the license can be found in the LICENSE.txt file.
+//
+//===----------------------------------------------------------------------===//
+//
+// Small, hot loops full of constants and integer arithmetic; the kind of code
+// the constant and arithmetic manglers hurt the most.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+  BufferSize = 4096,
+  DefaultIterations = 20000,
+};
+
+static uint32_t buffer[BufferSize];
+
+__attribute__((noinline)) static void scramble(uint32_t *data, unsigned size) {
+  for (unsigned i = 0; i < size; ++i) {
+    uint32_t x = data[i];
+    x ^= x >> 7;
+    x = x * 0x9e3779b1u + i;
+    x ^= x << 9;
+    data[i] = x;
+  }
+}
+
+__attribute__((noinline)) static uint32_t adler32(uint32_t const *data,
+                                                  unsigned size) {
+  uint32_t a = 1, b = 0;
+  for (unsigned i = 0; i < size; ++i) {
+    a = (a + (data[i] & 0xff)) % 65521;
+    b = (b + a) % 65521;
+  }
+
+  return (b << 16) | a;
+}
+
+__attribute__((noinline)) static uint64_t dot(uint32_t const *data,
+                                              unsigned size) {
+  uint64_t sum = 0;
+  for (unsigned i = 0; i + 1 < size; i += 2)
+    sum += (uint64_t)(data[i] & 0xffff) * (data[i + 1] & 0xffff);
+
+  return sum;
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? (unsigned)atoi(argv[1]) : DefaultIterations;
+
+  uint32_t seed = 12345;
+  for (unsigned i = 0; i < BufferSize; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    buffer[i] = seed;
+  }
+
+  uint64_t result = 0;
+  for (unsigned i = 0; i < iterations; ++i) {
+    scramble(buffer, BufferSize);
+    result += adler32(buffer, BufferSize);
+    result ^= dot(buffer, BufferSize);
+  }
+
+  printf("%llu\n", (unsigned long long)result);
+  return 0;
+}
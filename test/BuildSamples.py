@@ -4,9 +4,11 @@ from argparse import ArgumentParser
 from dataclasses import dataclass
 from enum import Enum
 from fnmatch import fnmatch
+import json
 import multiprocessing
 import subprocess
-from typing import Tuple
+import sys
+from typing import List, Tuple
 
 SOURCE_DIR = "test/Samples"
 CONFIG_DIR = "test/Configs"
@@ -40,7 +42,13 @@ class Sample:
 
         return f"{self.name()}.{tag}"
 
-    def build(self, context: Context, opt_type: str, with_obfuscation: bool = True):
+    def build(
+        self,
+        context: Context,
+        opt_type: str,
+        with_obfuscation: bool = True,
+        extra_args: List[str] = [],
+    ):
         output_path = f"{BUILD_DIR}/{self.output_name(opt_type, with_obfuscation)}"
         source_path = f"{SOURCE_DIR}/{self.source}"
 
@@ -54,6 +62,7 @@ class Sample:
                 "-mllvm",
                 f"-limoncello-config={CONFIG_DIR}/{self.config}.yml",
             ]
+        args += extra_args
         args += ["-" + opt_type, "-o", output_path, source_path]
 
         subprocess.run(args)
@@ -61,22 +70,90 @@ class Sample:
 
 ALL_SAMPLES = [
     Sample(SampleType.EXECUTABLE, "ArithmeticBonanza.c", "ArithmeticMangler"),
+    Sample(SampleType.EXECUTABLE, "ArithmeticBonanza.c", "ArithmeticManglerBudget"),
+    Sample(SampleType.EXECUTABLE, "ArithmeticBonanza.c", "ArithmeticManglerInPlace"),
     Sample(SampleType.EXECUTABLE, "ConstantPaloozaRedux.c", "ConstantMangler"),
+    Sample(SampleType.EXECUTABLE, "ConstantPaloozaRedux.c", "ConstantManglerHoisted"),
     Sample(SampleType.EXECUTABLE, "DoubleSwitch.c", "Flattener"),
+    Sample(SampleType.EXECUTABLE, "DoubleSwitch.c", "DispatchProfileInstrumented"),
+    Sample(SampleType.EXECUTABLE, "DoubleSwitch.c", "DispatchProfileUse"),
     Sample(SampleType.EXECUTABLE, "Hello.c", "Default"),
     Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "Flattener"),
     Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "FlattenerRandomIDs"),
+    Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "FlattenerRegions"),
+    Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "FlattenerThreaded"),
     Sample(SampleType.EXECUTABLE, "SimpleBlocks.c", "Bloater"),
+    Sample(SampleType.EXECUTABLE, "SimpleBlocks.c", "BloaterInlinePredicates"),
     Sample(SampleType.EXECUTABLE, "SayHello.c", "StringObfuscator"),
+    Sample(SampleType.EXECUTABLE, "SayHello.c", "StringObfuscatorLazy"),
+    Sample(SampleType.EXECUTABLE, "SensitiveStrings.c", "StringObfuscatorSelective"),
     Sample(SampleType.LIBRARY, "SayHelloLibrary.c", "StringObfuscator"),
+    Sample(SampleType.LIBRARY, "SayHelloLibrary.c", "StringObfuscatorLazy"),
     Sample(
         SampleType.EXECUTABLE,
         "NumberClassifier.c",
         "Everything",
     ),
+    Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "Parallel"),
+    Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "Hotness"),
+    Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "LatePlacement"),
+    Sample(SampleType.EXECUTABLE, "Overrides.c", "Everything"),
+    Sample(SampleType.EXECUTABLE, "Overrides.c", "Parallel"),
 ]
 
 
+# Samples whose reports must disagree on a counter, showing that it is really
+# measured from the input: (pass, counter, samples).
+REPORT_CHECKS = [
+    (
+        "flattener",
+        "values-demoted",
+        [
+            Sample(SampleType.EXECUTABLE, "SimpleBlocks.c", "Flattener"),
+            Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "Flattener"),
+        ],
+    ),
+    (
+        "bloater",
+        "values-demoted",
+        [
+            Sample(SampleType.EXECUTABLE, "SimpleBlocks.c", "Bloater"),
+            Sample(SampleType.EXECUTABLE, "NumberClassifier.c", "Bloater"),
+        ],
+    ),
+]
+
+
+def get_report_total(context: Context, sample: Sample, pass_name: str, counter: str) -> int:
+    # Optimized builds keep values in registers across blocks, so there is
+    # something for SSA repairs to demote.
+    report_path = f"{BUILD_DIR}/{sample.output_name('O2')}.json"
+    sample.build(context, "O2", extra_args=["-mllvm", f"-limoncello-report={report_path}"])
+
+    with open(report_path) as f:
+        report = json.load(f)
+    for record in report["passes"]:
+        if record["name"] == pass_name:
+            return record["totals"].get(counter, 0)
+
+    return 0
+
+
+def check_reports(context: Context) -> bool:
+    passed = True
+    for pass_name, counter, samples in REPORT_CHECKS:
+        totals = [get_report_total(context, s, pass_name, counter) for s in samples]
+        names = ", ".join(f"{s.source}: {t}" for s, t in zip(samples, totals))
+        if len(set(totals)) == len(totals) and all(t > 0 for t in totals):
+            print(f"Checked {pass_name} {counter} ({names})")
+            continue
+
+        print(f"Expected distinct, non-zero {pass_name} {counter} ({names})")
+        passed = False
+
+    return passed
+
+
 def build_sample(sample_with_context: Tuple[Sample, Context]):
     (sample, context) = sample_with_context
 
@@ -120,6 +197,12 @@ if __name__ == "__main__":
         metavar="N",
         default=8,
     )
+    parser.add_argument(
+        "--check-reports",
+        dest="check_reports",
+        action="store_true",
+        help="also check that report counters depend on the input",
+    )
 
     args = parser.parse_args()
 
@@ -128,3 +211,6 @@ if __name__ == "__main__":
 
     build_pool = multiprocessing.Pool(processes=args.jobs)
     build_pool.map(build_sample, samples)  # pyright: ignore
+
+    if args.check_reports and not check_reports(context):
+        sys.exit(1)
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// Hot enough that nothing should touch it.
+__attribute__((annotate("limoncello:none"))) static unsigned
+checksum(char const *data) {
+  unsigned sum = 0;
+  for (; *data; ++data)
+    sum = sum * 31 + (unsigned char)*data;
+  return sum;
+}
+
+__attribute__((annotate("limoncello:no-flattener")))
+__attribute__((annotate("limoncello:bloater.rounds=1,bloater.probability=25")))
+static int scale(int value) {
+  if (value < 0)
+    return -value * 3;
+  if (value > 100)
+    return value / 2;
+  return value * 2 + 1;
+}
+
+__attribute__((annotate("limoncello:arithmetic-mangler.rounds=1"))) static int
+mix(int a, int b) {
+  return (a ^ b) + (a & b) - (a | 7);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <text>\n", argv[0]);
+    return 1;
+  }
+
+  int value = atoi(argv[1]);
+  printf("checksum: %u\n", checksum(argv[1]));
+  printf("scale: %d\n", scale(value));
+  printf("mix: %d\n", mix(value, 42));
+
+  return 0;
+}
@@ -0,0 +1,23 @@
+#include <stdio.h>
+
+static char const *sensitive_keys[] = {
+    "correct horse battery staple",
+    "hunter2",
+};
+
+void sensitive_printKeys(void) {
+  for (unsigned i = 0; i < sizeof(sensitive_keys) / sizeof(*sensitive_keys);
+       ++i)
+    puts(sensitive_keys[i]);
+}
+
+void sensitive_greet(char const *name) { printf("Welcome back, %s.\n", name); }
+
+int main(int argc, char **argv) {
+  (void)argc;
+
+  puts("This string is not sensitive.");
+  sensitive_greet(argv[0]);
+  sensitive_printKeys();
+  return 0;
+}